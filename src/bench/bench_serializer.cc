@@ -0,0 +1,186 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../common/serializer.hh"
+
+/*
+ * Encode/decode throughput of every message body.
+ * Bodies are sized after what a busy server actually sends: a page
+ * of lobbies, a full game recording, a long chat history...
+ *
+ * Run with: make bench_serializer && ./bench_serializer [seconds per case]
+ */
+
+using NM::Message;
+using Request  = Networkable::Request;
+using Encoding = Networkable::Encoding;
+
+//    ╔═══════════════════════╗
+//    ║ Allocation Accounting ║
+//    ╚═══════════════════════╝
+
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+// Keeps the compiler from discarding results that are never read
+template<typename T>
+static inline void keep(T&& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+//    ╔══════════════════╗
+//    ║ Realistic Bodies ║
+//    ╚══════════════════╝
+
+static std::vector<std::string> lines(size_t count, size_t length) {
+  std::vector<std::string> result;
+  for (size_t i = 0; i < count; ++i)
+    result.emplace_back("player" + std::to_string(i % 7) + ": " + std::string(length, static_cast<char>('a' + i % 26)));
+  return result;
+}
+
+static std::vector<std::string> names(size_t count) {
+  std::vector<std::string> result;
+  for (size_t i = 0; i < count; ++i)
+    result.emplace_back("captain_" + std::to_string(i));
+  return result;
+}
+
+static Message::Matches matches(size_t count) {
+  Message::Matches result;
+  for (size_t i = 0; i < count; ++i) {
+    Message::Matches::Match match{};
+    std::string name = "Lobby number " + std::to_string(i);
+    ranges::copy(name, match.name.data());
+    match.players  = static_cast<uint8_t>(i % 2 + 1);
+    match.started  = i % 3 == 0;
+    match.password = i % 4 == 0;
+    result.push_back(match);
+  }
+  return result;
+}
+
+static Message::ServerFire fire(size_t cells, int turn) {
+  std::vector<Message::ServerFire::Cell> result;
+  for (size_t i = 0; i < cells; ++i)
+    result.push_back({BoardCoordinates(i % 10, (i * 3 + static_cast<size_t>(turn)) % 10), static_cast<int>(i), GameModel::HIT});
+  return Message::ServerFire(result, turn % 2 == 0, turn % 2 == 1, turn % 20);
+}
+
+static std::vector<BoardCoordinates> coordinates(size_t count) {
+  std::vector<BoardCoordinates> result;
+  for (size_t i = 0; i < count; ++i)
+    result.emplace_back(i % 10, i / 10);
+  return result;
+}
+
+//    ╔═════════════╗
+//    ║ Measurement ║
+//    ╚═════════════╝
+
+struct Rate {
+  double per_second;
+  double allocations;
+};
+
+/**
+ * Runs an operation in batches until the time budget is spent.
+ *
+ * \param Seconds to spend.
+ * \param Operation, run once per message.
+ * \return Messages per second and allocations per message.
+ */
+template<typename F>
+static Rate measure(double seconds, F&& operation) {
+  using clock = std::chrono::steady_clock;
+  operation();  // Warm up caches and allocator
+
+  uint64_t count = 0;
+  uint64_t before = allocations.load(std::memory_order_relaxed);
+  auto start = clock::now();
+  std::chrono::duration<double> elapsed{};
+
+  for (uint64_t batch = 16; elapsed.count() < seconds; batch *= 2) {
+    for (uint64_t i = 0; i < batch; ++i)
+      operation();
+    count  += batch;
+    elapsed = clock::now() - start;
+  }
+
+  uint64_t allocated = allocations.load(std::memory_order_relaxed) - before;
+  return {static_cast<double>(count) / elapsed.count(), static_cast<double>(allocated) / static_cast<double>(count)};
+}
+
+static double seconds_per_case = 0.25;
+
+template<typename T>
+static void bench(const char* name, Request request, const T& body) {
+  const auto compact = Message::serialize(Message(request, body));
+
+  auto encode = measure(seconds_per_case, [&] {
+    auto frame = Message::serialize(Message(request, body));
+    keep(frame);
+  });
+
+  // The received frame is copied first as read_messages() hands over an owned buffer
+  auto decode = measure(seconds_per_case, [&] {
+    auto content = Message::deserialize(std::vector<std::byte>(compact)).extract<T>();
+    keep(content);
+  });
+
+  std::printf("%-18s %8zu | %11.0f %6.1f %11.0f %6.1f\n", name, compact.size(),
+              encode.per_second, encode.allocations, decode.per_second, decode.allocations);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1)
+    seconds_per_case = std::atof(argv[1]);
+
+  std::printf("%-18s %8s | %11s %6s %11s %6s\n", "", "size", "encode/s", "alloc", "decode/s", "alloc");
+
+  Lobby::parameter_t params{chrono::seconds(600), chrono::seconds(30), Timer::Type::TURN, GameModel::GameMode::COMMANDERS};
+  std::vector<Message::SlotLobby> clients{Message::SlotLobby("captain_0", Message::SlotLobby::Slot::LEFT),
+                                          Message::SlotLobby("captain_1", Message::SlotLobby::Slot::RIGHT),
+                                          Message::SlotLobby("captain_2"), Message::SlotLobby("captain_3"),
+                                          Message::SlotLobby("captain_4")};
+  std::vector<Message::ServerFire> moves;
+  for (int turn = 0; turn < 200; ++turn)
+    moves.push_back(fire(static_cast<size_t>(turn % 9 + 1), turn));
+
+  bench("Hello",            Request::HELLO, Message::Hello(Encoding::LATEST));
+  bench("Credentials",      Request::LOGIN, Message::Credentials("captain_0", "correct horse battery staple"));
+  bench("Relationship",     Request::UPDATE_RELATIONSHIPS, Message::Relationship("captain_0", "captain_1", Message::Relationship::Kind::ACCEPTING));
+  bench("ChatLog 500",      Request::LOAD_CHAT, Message::ChatLog("captain_1", lines(500, 60)));
+  bench("ChatUpdate",       Request::CHAT_MESSAGE, Message::ChatUpdate("captain_0", "captain_1", lines(1, 60).front()));
+  bench("Account",          Request::LOGIN, Message::Account("captain_0", names(40), names(5), names(5), names(3)));
+  bench("Matches 10",       Request::GET_MATCHES, matches(10));
+  bench("HostLobby",        Request::HOST, Message::HostLobby("The Black Pearl", "parley"));
+  bench("JoinLobby",        Request::JOIN, Message::JoinLobby(Message::HostLobby("The Black Pearl", "parley"), Message::LobbyParameters(params), clients));
+  bench("SlotLobby",        Request::UPDATE_LOBBY_MEMBER, clients.front());
+  bench("LobbyParameters",  Request::UPDATE_LOBBY, Message::LobbyParameters(params));
+  bench("Faction",          Request::GAME, Message::Faction(GameModel::Faction::PIRATE));
+  bench("BoatSelection",    Request::GAME, Message::BoatSelection(Boat::Type::Carrier));
+  bench("Confirmation",     Request::GAME, Message::Confirmation(coordinates(5), 3, Boat::Type::Carrier));
+  bench("StartCombat",      Request::GAME, Message::StartCombat(true));
+  bench("AbilitySelection", Request::GAME, Message::AbilitySelection(Ability::Type::XBomb));
+  bench("ClientFire",       Request::GAME, Message::ClientFire(coordinates(9), Ability::Type::XBomb));
+  bench("ServerFire",       Request::GAME, fire(9, 1));
+  bench("GameEnd",          Request::GAMEOVER, Message::GameEnd(GameModel::Victor::LEFT));
+  bench("Recording 200",    Request::RECORDING, Message::Recording("captain_0", "captain_1", moves));
+
+  return 0;
+}
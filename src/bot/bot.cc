@@ -0,0 +1,387 @@
+#include "bot.hh"
+
+#include <algorithm>
+#include <charconv>
+#include <iomanip>
+#include <iterator>
+#include <string_view>
+
+#include "../common/utils.hh"
+
+using NM::Message;
+using Request = Networkable::Request;
+
+//                   ╔═══════════╗
+//                   ║ Latencies ║
+//                   ╚═══════════╝
+
+void Latencies::report(std::ostream& out, Clock::duration elapsed) {
+  static constexpr std::array<std::string_view, K_SENTINEL> NAMES{
+    "register", "login", "matches", "host", "join", "friend", "seat",
+    "start", "select", "place", "fire", "chat", "lobby"
+  };
+  using milliseconds = std::chrono::duration<double, std::milli>;
+
+  out << std::left << std::setw(10) << "request" << std::right << std::setw(10) << "count";
+  for (std::string_view column : {"p50 ms", "p90 ms", "p99 ms", "max ms"})
+    out << std::setw(10) << column;
+  out << '\n' << std::fixed << std::setprecision(3);
+
+  size_t total = 0;
+  for (size_t kind = 0; kind < K_SENTINEL; ++kind) {
+    std::vector<Clock::duration>& latencies = samples.at(kind);
+    if (latencies.empty())
+      continue;
+    ranges::sort(latencies);
+    total += latencies.size();
+
+    auto percentile = [&latencies](double fraction) {
+      size_t rank = static_cast<size_t>(fraction * static_cast<double>(latencies.size()));
+      return milliseconds(latencies.at(std::min(rank, latencies.size() - 1))).count();
+    };
+    out << std::left << std::setw(10) << NAMES.at(kind) << std::right << std::setw(10) << latencies.size()
+        << std::setw(10) << percentile(0.5) << std::setw(10) << percentile(0.9) << std::setw(10) << percentile(0.99)
+        << std::setw(10) << milliseconds(latencies.back()).count() << '\n';
+  }
+
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  out << std::setprecision(1) << total << " round trips in " << seconds << " s, "
+      << static_cast<double>(total) / seconds << " per second\n";
+}
+
+//                   ╔═════╗
+//                   ║ Bot ║
+//                   ╚═════╝
+
+Bot::Bot(std::string name, Role role, std::string lobby, size_t matches, uint32_t seed, Latencies& latencies, Send send)
+  : _name{std::move(name)}, role{role}, lobby{std::move(lobby)}, matches{matches},
+    latencies{latencies}, out{std::move(send)}, random{seed} {}
+
+void Bot::send(Latencies::Kind kind, Message&& message) {
+  sent.at(kind) = Clock::now();
+  out(std::move(message));
+}
+
+void Bot::received(Latencies::Kind kind) {
+  latencies.record(kind, Clock::now() - sent.at(kind));
+}
+
+void Bot::fail() {
+  if (settled())
+    return;
+  _phase = Phase::FAILED;
+  view    = nullptr;
+  control = nullptr;
+}
+
+void Bot::start() {
+  _phase = Phase::AUTHENTICATING;
+  send(Latencies::REGISTER, Message(Request::REGISTER, Message::Credentials(_name, _name)));
+}
+
+void Bot::handle(const Message& message) {
+  if (settled())
+    return;
+
+  switch (message.request()) {
+    using enum Networkable::Request;
+    case REGISTER:
+      // Taken already if the server kept its accounts from an earlier run, logged in either way
+      if (message.extract<Message::Account>()) {
+        received(Latencies::REGISTER);
+        out(Message(LOGOUT));  // To log in again, which is what returning players do
+      }
+      send(Latencies::LOGIN, Message(LOGIN, Message::Credentials(_name, _name)));
+      break;
+    case LOGIN:
+      authenticated(message);
+      break;
+    case GET_MATCHES:
+      received(Latencies::MATCHES);
+      send(Latencies::JOIN, Message(JOIN, Message::HostLobby(lobby, "")));
+      break;
+    case HOST:
+      received(Latencies::HOST);
+      _phase = Phase::LOBBY;
+      send(Latencies::SEAT, Message(UPDATE_LOBBY_MEMBER, Message::SlotLobby(_name, Message::SlotLobby::Slot::LEFT)));
+      break;
+    case JOIN:
+      received(Latencies::JOIN);
+      _phase = Phase::LOBBY;
+      send(Latencies::FRIEND, Message(UPDATE_RELATIONSHIPS, Message::Relationship(_name, partner->name(), Message::Relationship::Kind::SENDING)));
+      break;
+    case UPDATE_RELATIONSHIPS:
+      befriended(message);
+      break;
+    case UPDATE_LOBBY_MEMBER:
+      seated(message);
+      break;
+    case START_GAME:
+      if (std::exchange(starting, false))
+        received(Latencies::START);
+      newGame();
+      break;
+    case GAME:
+    case GAMEOVER:
+      play(message);
+      break;
+    case RECORDING:
+      ++_played;
+      view    = nullptr;
+      control = nullptr;
+      send(Latencies::LOBBY, Message(BACK_TO_LOBBY));
+      break;
+    case BACK_TO_LOBBY:
+      received(Latencies::LOBBY);
+      backInLobby();
+      break;
+    case CHAT_MESSAGE:
+      if (auto update = message.extract_view<Message::ChatUpdate>()) {
+        Clock::rep stamp = 0;
+        std::from_chars(update->line.data(), update->line.data() + update->line.size(), stamp);
+        latencies.record(Latencies::CHAT, Clock::now() - Clock::time_point(Clock::duration(stamp)));
+      }
+      break;
+    default:
+      break;  // Lobby and friend updates of others change nothing for a bot
+  }
+}
+
+void Bot::tick(Clock::time_point now) {
+  if (starting && now - sent.at(Latencies::START) > RETRY)
+    startMatch();
+}
+
+//                   ╔══════════╗
+//                   ║ Sessions ║
+//                   ╚══════════╝
+
+void Bot::authenticated(const Message& message) {
+  if (!message.extract<Message::Account>()) {
+    fail();
+    return;
+  }
+  received(Latencies::LOGIN);
+  _phase    = Phase::MENU;
+  logged_in = true;
+
+  if (role == Role::HOST)
+    send(Latencies::HOST, Message(Request::HOST, Message::HostLobby(lobby, "")));
+  else if (partner->lobby_ready)
+    join();
+}
+
+void Bot::join() {
+  send(Latencies::MATCHES, Message(Request::GET_MATCHES));  // As a player would, before picking the lobby
+}
+
+void Bot::befriended(const Message& message) {
+  using enum Message::Relationship::Kind;
+  auto relation = message.extract_view<Message::Relationship>();
+  if (!relation || relation->other != partner->name())
+    return;
+
+  switch (relation->k) {
+    case SENDING:
+      received(Latencies::FRIEND);
+      break;
+    case RECEIVING:
+      send(Latencies::FRIEND, Message(Request::UPDATE_RELATIONSHIPS, Message::Relationship(_name, partner->name(), ACCEPTING)));
+      break;
+    case ACCEPTING:
+      if (role == Role::HOST) {
+        received(Latencies::FRIEND);
+      } else {
+        send(Latencies::SEAT, Message(Request::UPDATE_LOBBY_MEMBER, Message::SlotLobby(_name, Message::SlotLobby::Slot::RIGHT)));
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void Bot::seated(const Message& message) {
+  using Slot = Message::SlotLobby::Slot;
+  auto member = message.extract_view<Message::SlotLobby>();
+  if (!member)
+    return;
+
+  Slot mine = role == Role::HOST ? Slot::LEFT : Slot::RIGHT;
+  if (member->name == _name && member->s == mine) {
+    received(Latencies::SEAT);
+    if (role == Role::HOST) {
+      lobby_ready = true;
+      if (partner->logged_in)
+        partner->join();
+    }
+  } else if (role == Role::HOST && member->name == partner->name() && member->s == Slot::RIGHT) {
+    startMatch();
+  }
+}
+
+void Bot::startMatch() {
+  starting = true;
+  send(Latencies::START, Message(Request::START_GAME));
+}
+
+//                   ╔═══════╗
+//                   ║ Games ║
+//                   ╚═══════╝
+
+void Bot::newGame() {
+  std::string host  = role == Role::HOST ? _name : partner->name();
+  std::string guest = role == Role::HOST ? partner->name() : _name;
+
+  view = std::make_shared<ClientView>(_name, std::pair{host, guest}, false);
+  view->setGamemode(GameModel::GameMode::CLASSIC);
+  control = std::make_shared<ClientControl>(view, &timer);
+  control->acceptFaction(Message(Request::GAME, Message::Faction(GameModel::Faction::CLASSIC)));
+
+  _phase = Phase::PLAYING;
+  shots  = 0;
+  selectShip();
+}
+
+void Bot::play(const Message& message) {
+  if (!view)
+    return;
+
+  if (message.request() == Request::GAMEOVER) {
+    control->endGame(message);
+    return;  // The recording follows
+  }
+
+  auto fired = message.extract_view<Message::ServerFire>();
+  GameModel::GameStage before = view->gameState();
+
+  switch (before) {
+    using enum GameModel::GameStage;
+    case SELECTION:
+      control->acceptSelect(message);
+      received(Latencies::SELECT);
+      if (view->gameState() == PLACEMENT) {
+        if (Message confirmation = placeShip(); !confirmation.empty())
+          send(Latencies::PLACE, std::move(confirmation));
+        else
+          fail();
+      }
+      break;
+    case PLACEMENT:
+      control->acceptPlace(message);
+      received(Latencies::PLACE);
+      if (view->gameState() == SELECTION)
+        selectShip();
+      break;
+    case WAITING:
+      control->acceptStart(message);
+      if (view->gameState() == COMBAT)
+        fire();
+      break;
+    case OTHERTURN:
+    case COMBAT:
+      control->acceptFire(message);
+      if (fired && !fired->your_board)
+        received(Latencies::FIRE);
+      if (view->gameState() == COMBAT && !view->isFinished())
+        fire();
+      break;
+    default:
+      break;  // Classic games have no faction nor ability to select
+  }
+}
+
+void Bot::selectShip() {
+  vector<Boat::Type> inventory = view->getInventory();
+  if (inventory.empty())
+    return;
+
+  Message selection = control->select(std::to_string(NM::to_underlying(inventory.front()) + 1));
+  if (selection.empty()) {
+    fail();
+    return;
+  }
+  send(Latencies::SELECT, std::move(selection));
+}
+
+Message Bot::placeShip() {
+  // Scans the board row by row with the moves a player has, until the
+  // ship neither overlaps nor touches another one, turning it once the
+  // bottom is reached
+  auto origin = [this] { return view->getLastBoat().getCoordinates()[0]; };
+
+  for (size_t step = 0; step < PLACEMENT_MOVES; ++step) {
+    if (Message confirmation = control->move('C'); !confirmation.empty())
+      return confirmation;
+
+    BoardCoordinates before = origin();
+    (void)control->move('D');
+    if (origin() != before)
+      continue;
+
+    (void)control->move('S');
+    if (origin() == before) {
+      (void)control->move('E');
+      for (size_t i = 0; i < BOARDSIZE; ++i)
+        (void)control->move('Z');
+    }
+    for (size_t i = 0; i < BOARDSIZE; ++i)
+      (void)control->move('Q');
+  }
+  return {};
+}
+
+void Bot::fire() {
+  view->setSelection(vector{target()});
+  Message shot = control->executeFire();
+  if (shot.empty()) {
+    fail();
+    return;
+  }
+  send(Latencies::FIRE, std::move(shot));
+
+  if (++shots % CHAT_EVERY == 0)
+    chat();
+}
+
+BoardCoordinates Bot::target() {
+  // Around hits first, then every other cell, which is enough to find
+  // every ship, then whatever is left
+  Bitboard open, hits, checkered;
+  for (size_t y = 0; y < BOARDSIZE; ++y) {
+    for (size_t x = 0; x < BOARDSIZE; ++x) {
+      BoardCoordinates c{x, y};
+      GameModel::CellType cell = view->getCell(false, c);
+      open.set(c, cell == GameModel::CellType::WATER);
+      hits.set(c, cell == GameModel::CellType::HIT);
+      checkered.set(c, (x + y) % 2 == 0);
+    }
+  }
+
+  Bitboard choices = hits.neighbours() & open;
+  if (choices.empty())
+    choices = open & checkered;
+  if (choices.empty())
+    choices = open;
+
+  std::uniform_int_distribution<size_t> pick(0, choices.count() - 1);
+  return *std::next(choices.begin(), static_cast<std::ptrdiff_t>(pick(random)));
+}
+
+void Bot::chat() {
+  // Sent time in the line, for the receiver to measure its delivery
+  std::string stamp = std::to_string(Clock::now().time_since_epoch().count());
+  out(Message(Request::CHAT_MESSAGE, Message::ChatUpdate(_name, partner->name(), stamp)));
+}
+
+void Bot::backInLobby() {
+  _phase = Phase::LOBBY;
+  if (_played >= matches) {
+    _phase = Phase::DONE;
+    return;
+  }
+
+  // Whoever comes back last has the host start the next match
+  Bot& host = role == Role::HOST ? *this : *partner;
+  if (partner->_phase == Phase::LOBBY)
+    host.startMatch();
+}
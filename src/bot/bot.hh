@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../client/client_board.hh"
+#include "../client/client_timer.hh"
+#include "../common/serializer.hh"
+
+/**
+ * Round trips measured by bots, from a request to the reply it waits for.
+ */
+class Latencies {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  enum Kind : uint8_t {
+    REGISTER,
+    LOGIN,
+    MATCHES,
+    HOST,
+    JOIN,
+    FRIEND,
+    SEAT,
+    START,
+    SELECT,
+    PLACE,
+    FIRE,
+    CHAT,   // From the sender to the receiver, there is no reply
+    LOBBY,  // Back to it after a match
+
+    K_SENTINEL
+  };
+
+  void record(Kind kind, Clock::duration latency) { samples.at(kind).push_back(latency); }
+
+  /**
+   * Writes a table of percentiles per kind, and the overall throughput.
+   *
+   * \param Stream to write to.
+   * \param Time the samples were gathered over.
+   */
+  void report(std::ostream& out, Clock::duration elapsed);
+
+ private:
+  std::array<std::vector<Clock::duration>, K_SENTINEL> samples;
+};
+
+/**
+ * Headless client playing on a script: it registers, logs in again,
+ * then either hosts a lobby or joins its partner's, befriends them, takes
+ * a seat and plays a number of classic matches, chatting now and then.
+ *
+ * Games go through ClientView and ClientControl like a human player's
+ * would; ships are placed by scanning the board with the same moves a
+ * player has, and shots hunt around hits before trying the rest of the
+ * board. The bot waits for the reply to each request before its next
+ * one, which makes every request a measured round trip.
+ */
+class Bot {
+ public:
+  using Clock = Latencies::Clock;
+  using Send  = std::function<void(NM::Message&&)>;
+
+  enum class Role : bool { HOST, GUEST };
+
+  enum class Phase : uint8_t {
+    CONNECTING,
+    AUTHENTICATING,
+    MENU,
+    LOBBY,
+    PLAYING,
+    DONE,
+    FAILED
+  };
+
+  /**
+   * \param Account name, also used as its password.
+   * \param Whether it hosts the lobby or joins it.
+   * \param Name of the lobby.
+   * \param Matches to play before being done.
+   * \param Seed of its shots.
+   * \param Where to record round trips.
+   * \param Sends a message to the server.
+   */
+  Bot(std::string name, Role role, std::string lobby, size_t matches, uint32_t seed, Latencies& latencies, Send send);
+
+  /**
+   * The other bot of the lobby, which must outlive this one.
+   */
+  inline void pair(Bot& partner) { this->partner = &partner; }
+
+  /**
+   * To call once connected to the server.
+   */
+  void start();
+
+  void handle(const NM::Message& message);
+
+  /**
+   * Gives up, for a connection that could not be made or was lost.
+   * Does nothing once done or failed already.
+   */
+  void fail();
+
+  /**
+   * Retries what the server may have ignored: a match cannot start again
+   * before the server has seen both players back in the lobby, which it
+   * learns after telling them.
+   */
+  void tick(Clock::time_point now);
+
+  [[nodiscard]] inline Phase              phase()   const { return _phase; }
+  [[nodiscard]] inline const std::string& name()    const { return _name; }
+  [[nodiscard]] inline size_t             played()  const { return _played; }
+  [[nodiscard]] inline bool               settled() const { return _phase == Phase::DONE || _phase == Phase::FAILED; }
+
+  Bot(Bot&&)      = delete;
+  Bot(const Bot&) = delete;
+
+ private:
+  static constexpr size_t CHAT_EVERY      = 5;    // Shots between two chat lines
+  static constexpr size_t PLACEMENT_MOVES = 400;  // Before giving up on a ship
+  static constexpr auto   RETRY           = std::chrono::milliseconds(200);
+
+  std::string _name;
+  Role role;
+  std::string lobby;
+  size_t matches;
+  size_t _played   = 0;
+  Phase _phase     = Phase::CONNECTING;
+  bool logged_in   = false;  // A guest joins once both it and the host's lobby are ready
+  bool lobby_ready = false;
+  bool starting    = false;  // START_GAME was sent, not answered yet
+
+  Bot* partner = nullptr;
+  Latencies& latencies;
+  Send out;
+  std::array<Clock::time_point, Latencies::K_SENTINEL> sent{};
+
+  std::mt19937 random;
+  size_t shots = 0;
+  ClientTimer timer;
+  std::shared_ptr<ClientView> view;
+  std::shared_ptr<ClientControl> control;
+
+  void send(Latencies::Kind kind, NM::Message&& message);
+  void received(Latencies::Kind kind);
+
+  void authenticated(const NM::Message& message);
+  void join();
+  void befriended(const NM::Message& message);
+  void seated(const NM::Message& message);
+  void startMatch();
+  void newGame();
+  void play(const NM::Message& message);
+  void selectShip();
+  [[nodiscard]] NM::Message placeShip();
+  void fire();
+  [[nodiscard]] BoardCoordinates target();
+  void chat();
+  void backInLobby();
+};
@@ -0,0 +1,248 @@
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include "bot.hh"
+#include "../common/network_io.hh"
+#include "../common/utils.hh"
+
+/*
+ * Capacity test of a running server: pairs of headless bots each get a
+ * lobby and play their matches through, all from one thread over
+ * non-blocking sockets. Reports round trip percentiles per request.
+ *
+ * Run with: make load_generator && ./load_generator [bots] [matches per pair] [server ip]
+ */
+
+using NM::Message;
+using Clock = Latencies::Clock;
+
+class LoadGenerator : protected Networkable {
+ public:
+  LoadGenerator(std::string ip, size_t bots, size_t matches);
+  ~LoadGenerator();
+
+  /**
+   * Connects the bots a few at a time and runs until every one of them is
+   * done, has failed, or nothing happened for a while.
+   *
+   * \return Whether every bot played all of its matches.
+   */
+  bool run();
+
+  LoadGenerator(LoadGenerator&&)      = delete;
+  LoadGenerator(const LoadGenerator&) = delete;
+
+ private:
+  static constexpr size_t RAMP    = 64;  // Connections opened per turn of the loop, under the server's backlog
+  static constexpr auto   TICK    = std::chrono::milliseconds(10);
+  static constexpr auto   STALLED = std::chrono::seconds(10);
+
+  struct Connection {
+    int fd = -1;
+    bool connected = false;
+    std::unique_ptr<Bot> bot;
+  };
+
+  sockaddr_in address{};
+  int epoll_fd;
+  std::vector<Connection> connections;
+  std::unordered_map<int, size_t> by_fd;
+  size_t opened = 0;
+
+  Latencies latencies;
+  size_t received = 0;
+  Clock::time_point last_progress;
+
+  void open(size_t index);
+  void connected(Connection& connection);
+  void receive(Connection& connection);
+  void transmit(size_t index, Message&& message);
+  void close(Connection& connection);
+};
+
+LoadGenerator::LoadGenerator(std::string ip, size_t bots, size_t matches) : epoll_fd{epoll_create1(EPOLL_CLOEXEC)} {
+  address.sin_family = AF_INET;
+  address.sin_port   = htons(PORT);
+  if (inet_pton(AF_INET, ip.c_str(), &address.sin_addr) != 1)
+    throw std::runtime_error("Invalid server address: " + ip);
+
+  // Names are unique to the run, accounts outlive it on the server
+  std::string run = std::to_string(getpid());
+  connections.resize(bots - bots % 2);
+  for (size_t i = 0; i < connections.size(); ++i) {
+    Bot::Role role = i % 2 == 0 ? Bot::Role::HOST : Bot::Role::GUEST;
+    connections[i].bot = std::make_unique<Bot>("b" + run + "_" + std::to_string(i), role, "l" + run + "_" + std::to_string(i / 2),
+                                               matches, static_cast<uint32_t>(i), latencies,
+                                               [this, i](Message&& message) { transmit(i, std::move(message)); });
+  }
+  for (size_t i = 0; i < connections.size(); i += 2) {
+    connections[i].bot->pair(*connections[i + 1].bot);
+    connections[i + 1].bot->pair(*connections[i].bot);
+  }
+}
+
+LoadGenerator::~LoadGenerator() {
+  for (Connection& connection : connections)
+    close(connection);
+  ::close(epoll_fd);
+}
+
+bool LoadGenerator::run() {
+  Clock::time_point start = Clock::now();
+  last_progress = start;
+  std::vector<epoll_event> events(1024);
+
+  while (!is_interrupted) {
+    for (size_t i = 0; i < RAMP && opened < connections.size(); ++i)
+      open(opened++);
+
+    int ready = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), static_cast<int>(TICK.count()));
+    if (ready == -1 && errno != EINTR)
+      break;
+
+    for (int i = 0; i < ready; ++i) {
+      auto it = by_fd.find(events[static_cast<size_t>(i)].data.fd);
+      if (it == by_fd.end())
+        continue;
+      Connection& connection = connections[it->second];
+      uint32_t flags = events[static_cast<size_t>(i)].events;
+
+      if (!connection.connected && flags & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+        connected(connection);
+      if (connection.fd != -1 && flags & EPOLLOUT && !flush(connection.fd))
+        close(connection);
+      if (connection.fd != -1 && flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        receive(connection);
+    }
+
+    Clock::time_point now = Clock::now();
+    for (Connection& connection : connections)
+      if (connection.fd != -1)
+        connection.bot->tick(now);
+
+    if (opened == connections.size() && ranges::all_of(connections, [](const Connection& c) { return c.bot->settled(); }))
+      break;
+    if (now - last_progress > STALLED)
+      break;
+  }
+
+  Clock::duration elapsed = Clock::now() - start;
+  size_t done = 0, failed = 0, matches = 0;
+  for (const Connection& connection : connections) {
+    done    += connection.bot->phase() == Bot::Phase::DONE;
+    failed  += connection.bot->phase() == Bot::Phase::FAILED;
+    matches += connection.bot->played();
+  }
+
+  latencies.report(std::cout, elapsed);
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  std::cout << connections.size() << " bots: " << done << " done, " << failed << " failed, "
+            << connections.size() - done - failed << " stuck\n"
+            << matches / 2 << " matches, " << static_cast<double>(matches / 2) / seconds << " per second; "
+            << received << " messages received, " << static_cast<double>(received) / seconds << " per second\n";
+  return done == connections.size();
+}
+
+void LoadGenerator::open(size_t index) {
+  Connection& connection = connections[index];
+  connection.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (connection.fd == -1) {
+    connection.bot->fail();  // Out of descriptors
+    return;
+  }
+
+  if (connect(connection.fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 && errno != EINPROGRESS) {
+    ::close(connection.fd);
+    connection.fd = -1;
+    connection.bot->fail();
+    return;
+  }
+  set_nodelay(connection.fd);  // Applies once the connection completes
+
+  epoll_event event{.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data{.fd = connection.fd}};
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection.fd, &event);
+  by_fd.emplace(connection.fd, index);
+}
+
+void LoadGenerator::connected(Connection& connection) {
+  int error = 0;
+  socklen_t size = sizeof(error);
+  if (getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &size) == -1 || error != 0) {
+    close(connection);
+    return;
+  }
+
+  connection.connected = true;
+  last_progress = Clock::now();
+  if (!greet(connection.fd)) {
+    close(connection);
+    return;
+  }
+  connection.bot->start();
+}
+
+void LoadGenerator::receive(Connection& connection) {
+  for (Message& message : read_messages(connection.fd)) {
+    if (message.empty()) {  // Hung up
+      close(connection);
+      return;
+    }
+    ++received;
+    last_progress = Clock::now();
+    connection.bot->handle(message);
+  }
+}
+
+void LoadGenerator::transmit(size_t index, Message&& message) {
+  Connection& connection = connections[index];
+  if (connection.fd != -1 && !write_message(connection.fd, std::move(message)))
+    close(connection);
+}
+
+void LoadGenerator::close(Connection& connection) {
+  if (connection.fd == -1)
+    return;
+  if (connection.connected)
+    write_message(connection.fd, Message(Request::DISCONNECT));
+  by_fd.erase(connection.fd);
+  forget(connection.fd);
+  ::close(connection.fd);  // Also removes it from the epoll set
+  connection.fd = -1;
+  connection.bot->fail();  // Unless it was done before
+}
+
+int main(int argc, char* argv[]) {
+  size_t bots    = 1000;
+  size_t matches = 1;
+  std::string ip = "127.0.0.1";
+  if (argc > 1)
+    if (auto value = NM::from_string(argv[1]); value && *value >= 2)
+      bots = static_cast<size_t>(*value);
+  if (argc > 2)
+    if (auto value = NM::from_string(argv[2]); value && *value > 0)
+      matches = static_cast<size_t>(*value);
+  if (argc > 3)
+    ip = argv[3];
+
+  // Each bot holds a socket and a timer
+  rlimit files;
+  if (getrlimit(RLIMIT_NOFILE, &files) == 0) {
+    files.rlim_cur = files.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &files);
+  }
+  if (set_sigaction() == -1)
+    return 1;
+
+  std::cerr.rdbuf(nullptr);  // The game model logs every move of every bot
+
+  LoadGenerator generator(ip, bots, matches);
+  return generator.run() ? 0 : 1;
+}
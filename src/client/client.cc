@@ -1,7 +1,6 @@
 ﻿#include "client.hh"
 #include <iostream>
 #include <ranges>
-#include <fstream>
 
 #include "../common/serializer.hh"
 
@@ -21,19 +20,19 @@ void SessionInfo::remove(vector<string>& relation, string_view username) {
     relation.erase(it);
 }
 
-void SessionInfo::updateRelation(const NM::Message::Relationship& relation) {
-  auto&& [you, other, kind] = relation.data();
+void SessionInfo::updateRelation(const NM::Message::Relationship::View& relation) {
+  auto&& [you, other, kind] = relation;
 
   switch (kind) {
     using enum NM::Message::Relationship::Kind;
     case SENDING:
-      relationships.at(REQUESTS_OUTBOUND).push_back(other);
+      relationships.at(REQUESTS_OUTBOUND).emplace_back(other);
       break;
     case RECEIVING:
-      relationships.at(REQUESTS_INBOUND).push_back(other);
+      relationships.at(REQUESTS_INBOUND).emplace_back(other);
       break;
     case ACCEPTING:
-      relationships.at(FRIENDS).push_back(other);
+      relationships.at(FRIENDS).emplace_back(other);
       remove(relationships.at(REQUESTS_OUTBOUND), other);
       remove(relationships.at(REQUESTS_INBOUND), other);
       break;
@@ -45,7 +44,7 @@ void SessionInfo::updateRelation(const NM::Message::Relationship& relation) {
       remove(relationships.at(FRIENDS), other);
       break;
     case SENDINGGAME:
-      relationships.at(GAME_REQUESTS).push_back(other);
+      relationships.at(GAME_REQUESTS).emplace_back(other);
       break;
     default:
       throw std::runtime_error("Updating relation failed with unknown enum value");
@@ -72,6 +71,7 @@ void Client::startGame(Lobby::parameter_t params, bool spec) {
   if (spec)
     board->setGameState(GameModel::GameStage::SPECTATING);
   game = std::make_unique<ConsoleGameDisplay>(std::cout, std::cin, board, control, &timer);
+  game->record(std::string(LAST_REPLAY));
 #endif
 }
 
@@ -100,6 +100,12 @@ Client::Client(string_view ip) : state{State::MENU} {
     failed();
     return;
   }
+  set_nodelay(server_fd);
+  if (!greet(server_fd)) {
+    failed();
+    return;
+  }
+  write_message(server_fd, timer.probe());
   if (set_sigaction() == -1) {
     write_message(server_fd, NM::Message(Networkable::Request::DISCONNECT));
     failed();
@@ -113,6 +119,8 @@ Client::Client(string_view ip) : state{State::MENU} {
 
 #ifdef GUI
   gui_thread = std::make_unique<GUIThread>(menu_data_t{view, control, lobby, std::experimental::make_observer(&session), &timer});
+  poll_fds[USER].fd = gui_thread->fd();  // Input comes from the window, sent on once it is a message
+  poll_fds[TIMER].fd = -1;  // Read on the window's thread, which owns the timer; poll skips it
 #else
   menu       = std::make_unique<ConsoleMenuDisplay>(std::cout, std::cin, view, control, lobby, std::experimental::make_observer(&session));
 #endif
@@ -144,14 +152,17 @@ void Client::watch() {
       default:
         throw NotImplementedError("Activity not implemented");
     }
-
-    poll(poll_fds.data(), 3, -1);
-#else
-    poll(poll_fds.data(), 3, 500);
 #endif
+    poll_fds[SERVER].events = pending(server_fd) ? POLLIN | POLLOUT : POLLIN;
+    poll(poll_fds.data(), 3, -1);
     if (is_interrupted)
       return;
 
+    if (poll_fds[SERVER].revents & POLLOUT && !flush(server_fd)) {
+      std::cout << "Connection lost to server!\n";
+      return;
+    }
+
 #ifndef GUI
     if (poll_fds[USER].revents & POLLIN) {
 
@@ -175,64 +186,68 @@ void Client::watch() {
 
     }
 #else
-    if (auto message = gui_thread->popMessage()) {
-      write_message(server_fd, std::move(*message));
+    if (poll_fds[USER].revents & POLLIN) {
+      for (NM::Message& message : gui_thread->popMessages())
+        write_message(server_fd, std::move(message));
     }
 #endif
     else if (poll_fds[SERVER].revents & POLLIN) {
 
-      NM::Message message = read_message(server_fd);
-
-      if (message.empty()) {
-        std::cout << "Connection lost to server!\n";
-        return;
-      } else if (message.request() == Networkable::Request::DISCONNECT) {
-        std::cout << "Server has shut down!\n";
-        return;
-      }
-      
-      if (message.request() == Networkable::Request::RECORDING) {
-        std::ofstream ofs("./last.replay", std::ios::binary);
-        auto body = message.get_body();
-        ofs.write(reinterpret_cast<const char*>(body.data()), body.size());
-      }
-
-      switch (state) {
-        using enum State;
-        case MENU:
-          if (message.request() == Networkable::Request::START_GAME || message.request() == Networkable::Request::START_SPECTATING) {
-            state = PLAYING;
-            bool spectator = message.request() == Networkable::Request::START_SPECTATING;
-            #ifndef GUI
-            startGame(menu->getLobbyParameters(), spectator);
-            #else
-            gui_thread->switchActiveState();
-            #endif
-            break;
-          }
+      for (NM::Message& message : read_messages(server_fd)) {
+        if (message.empty()) {
+          std::cout << "Connection lost to server!\n";
+          return;
+        } else if (message.request() == Networkable::Request::DISCONNECT) {
+          std::cout << "Server has shut down!\n";
+          return;
+        } else if (message.request() == Networkable::Request::CLOCK) {
 #ifndef GUI
-          menu->handleServer(message);
+          if (NM::Message next = timer.acceptClock(message); !next.empty())
+            write_message(server_fd, std::move(next));
 #else
-          gui_thread->menuHandleServer(message);
+          gui_thread->clockHandleServer(message);
 #endif
-          break;
-
-        case PLAYING:
+          continue;
+        }
+
+        switch (state) {
+          using enum State;
+          case MENU:
+            if (message.request() == Networkable::Request::START_GAME || message.request() == Networkable::Request::START_SPECTATING) {
+              state = PLAYING;
+              bool spectator = message.request() == Networkable::Request::START_SPECTATING;
+              #ifndef GUI
+              write_message(server_fd, timer.probe());  // Clocks drift apart, measured again each match
+              startGame(menu->getLobbyParameters(), spectator);
+              #else
+              gui_thread->switchActiveState();
+              #endif
+              break;
+            }
 #ifndef GUI
-          if (message.request() == Networkable::Request::BACK_TO_LOBBY) {
-            state = State::MENU;
-            game = nullptr;
+            menu->handleServer(message);
+#else
+            gui_thread->menuHandleServer(message);
+#endif
             break;
-          }
+
+          case PLAYING:
+#ifndef GUI
+            if (message.request() == Networkable::Request::BACK_TO_LOBBY) {
+              state = State::MENU;
+              game = nullptr;
+              break;
+            }
 #endif
 #ifndef GUI
-          game->handleServer(message);
+            game->handleServer(message);
 #else
-          gui_thread->gameHandleServer(message);
+            gui_thread->gameHandleServer(message);
 #endif
-          break;
-        default:
-          throw ("Client.cc handle state not implemented");
+            break;
+          default:
+            throw ("Client.cc handle state not implemented");
+        }
       }
 
     } else if (poll_fds[SERVER].revents & (POLLPRI | POLLRDHUP | POLLERR | POLLHUP | POLLNVAL)) {
@@ -243,12 +258,8 @@ void Client::watch() {
     }
     
   #ifndef GUI
-    if (poll_fds[TIMER].revents & POLLIN) {
-      if (timer.on())
-        timer.update();
-      if (timer.turnDone() || timer.done())
-        write_message(server_fd, NM::Message(Networkable::Request::OUT_OF_TIME));
-    }
+    if (poll_fds[TIMER].revents & POLLIN && timer.update())
+      write_message(server_fd, NM::Message(Networkable::Request::OUT_OF_TIME));
   #endif 
  
   }
@@ -260,7 +271,6 @@ int main(int argc, char* argv[]) {
   string ip = "127.0.0.1";
   if (argc > 1) ip = argv[1];
   Client c(ip);
-  std::system("clear");  // Stop touching this FOR THE LOVE OF GOD
   c.watch();
 
   return 0;
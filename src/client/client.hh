@@ -36,7 +36,7 @@ class SessionInfo {
   SessionInfo() = default;
 
   void newSession(const NM::Message::Account& account);
-  void updateRelation(const NM::Message::Relationship& relation);
+  void updateRelation(const NM::Message::Relationship::View& relation);
   void clear() noexcept;
 
   [[nodiscard]] inline string             getUsername()     const { return username; }
@@ -20,17 +20,18 @@ namespace views = ranges::views;
 //                   ╚═══════════╝
 
 void ClientView::findFreeSpot(ClientBoat& new_boat) {
-  while (!new_boat.inBoundsH() || overlaps(new_boat)) {
-    if (!new_boat.inBoundsH()) {
-      int line_feed = new_boat.origin().x();
-      new_boat.shift({-line_feed, 1});
-    } else {
-      new_boat.shift({1, 0});
+  Bitboard taken = placed();
+  for (size_t y = 0; y < BOARDSIZE; ++y) {
+    for (size_t x = 0; x < BOARDSIZE; ++x) {
+      Bitboard spot = Boat::footprint(new_boat.getType(), 0, {x, y});
+      if (!spot.empty() && (spot & taken).empty()) {
+        new_boat.setCoordinates(Boat::assembleByType(new_boat.getType(), {x, y}));
+        return;
+      }
     }
   }
 
-  if (!new_boat.inBoundsV())
-    throw std::runtime_error("Could not find free spot for ship");  // We want to use the entire inventory
+  throw std::runtime_error("Could not find free spot for ship");  // We want to use the entire inventory
 }
 
 ClientView::ClientView(std::string_view you, std::pair<std::string, std::string> names, bool is_spectator) {
@@ -43,30 +44,27 @@ ClientView::ClientView(std::string_view you, std::pair<std::string, std::string>
     name_other = names.second;
     is_left = true;
   }
-  for (auto&& row : _view_left)
-    row.fill(CellType::WATER);
-  for (auto&& row : _view_right)
-    row.fill(CellType::WATER);
-  for (auto&& row : _overlay)
-    row.fill(OverlayCell::NONE);
 }
 
 ClientView::ClientView(std::string_view left, std::string_view right) {
   name_you = left;
   name_other = right;
   is_left = true;
+}
 
-  for (auto&& row : _view_left)
-    row.fill(CellType::WATER);
-  for (auto&& row : _view_right)
-    row.fill(CellType::WATER);
-  for (auto&& row : _overlay)
-    row.fill(OverlayCell::NONE);
+Bitboard ClientView::placed() const {
+  Bitboard mask;
+  for (const ClientBoat& boat : your_fleet | views::take(your_fleet.size() - 1))  // Assume the last one is being placed
+    mask |= boat.mask();
+  return mask;
 }
 
-bool ClientView::overlaps(ClientBoat& new_boat) const {
-  return ranges::any_of(your_fleet | views::take(your_fleet.size() - 1),  // Assume new_boat is already in fleet
-                        [&new_boat](const ClientBoat& boat) { return boat.contains(new_boat); });
+bool ClientView::overlaps(const ClientBoat& new_boat) const {
+  return !(placed() & new_boat.mask()).empty();
+}
+
+bool ClientView::touches(const ClientBoat& new_boat) const {
+  return !(placed() & new_boat.mask().neighbours()).empty();
 }
 
 bool ClientView::inInventory(Boat::Type type) const {
@@ -75,14 +73,13 @@ bool ClientView::inInventory(Boat::Type type) const {
 }
 
 bool ClientView::isSameShip(BoardCoordinates first, BoardCoordinates second, bool your_side) const {
-  return your_side ? ranges::any_of(your_fleet,  [&first, &second](const ClientBoat& boat) { return boat.contains(first) && boat.contains(second); })
-                   : ranges::any_of(enemy_fleet, [&first, &second](const ClientBoat& boat) { return boat.contains(first) && boat.contains(second); });
+  int id = shipAt(your_side, first);
+  return id != 0 && id == shipAt(your_side, second);
 }
 
 std::optional<int> ClientView::whichShip(BoardCoordinates coordinates) const {
-  auto it = ranges::find_if(your_fleet, [&coordinates](const ClientBoat& boat) { return boat.contains(coordinates); });
-  if (it != your_fleet.end())
-    return it->getId();
+  if (int id = shipAt(true, coordinates))
+    return id;
   return std::nullopt;
 }
 
@@ -118,17 +115,26 @@ void ClientView::addShip(Boat::Type type) {
   inventory.erase(it);
 
   int id = your_fleet.size() == 0 ? 1 : your_fleet.back().getId() + 1;
-  ClientBoat new_boat{type, id, Boat::assembleByType(type, {0, 0})};
   findFreeSpot(your_fleet.emplace_back(ClientBoat{type, id, Boat::assembleByType(type, {0, 0})}));
   
-  for (auto&& c : your_fleet.back().getCoordinates()) {
-    _view_left.at(c.y()).at(c.x()) = CellType::UNDAMAGED;
-  }
+  _view_left.ships |= your_fleet.back().mask();
+  for (auto&& c : your_fleet.back().getCoordinates())
+    setShip(true, c, id);
+}
+
+void ClientView::pushBoat(ClientBoat new_boat, bool your_side) {
+  for (auto&& c : new_boat.getCoordinates())
+    setShip(your_side, c, new_boat.getId());
+  (your_side ? your_fleet : enemy_fleet).push_back(new_boat);
+}
+
+void ClientView::setShip(bool your_side, BoardCoordinates coordinate, int id) {
+  if (Bitboard::inBounds(coordinate))
+    (your_side ? _ships_left : _ships_right)[coordinate.y()][coordinate.x()] = id;
 }
 
 void ClientView::setCell(bool your_side, BoardCoordinates coordinate, GameModel::CellType type) {
-  auto&& side = your_side ? _view_left : _view_right;
-  side[coordinate.y()][coordinate.x()] = type;
+  (your_side ? _view_left : _view_right).set(coordinate, type);
 }
 
 //                   ╔═══════════════╗
@@ -143,15 +149,13 @@ void ClientControl::do_move_selection(BoardCoordinates::Transform transform) {
   if (view->getGamemode() == GameModel::GameMode::CLASSIC)  // Fixes exception thrown in assemleByType
     chosen_ability = Ability::Type::Basic;
 
-  ClientBoat boat = ClientBoat(Boat::Type::SENTINEL, -1, chosen_ability.assembleByType(chosen_ability.getType(), view->getSelection().at(0)));
+  BoardCoordinates origin = view->getSelection().at(0);
+  Footprint old_cells     = Ability::assembleByType(chosen_ability.getType(), origin);
 
-  span<BoardCoordinates> cells = boat.getCoordinates();
-  vector<BoardCoordinates> old_cells(cells.begin(), cells.end());
-
-  boat.shift(transform);
-  if (!boat.inBoundsH() || !boat.inBoundsV()) {
-    boat.setCoordinates(old_cells);
-  }
+  origin += transform;
+  Footprint cells = Ability::assembleByType(chosen_ability.getType(), origin);
+  if (!ranges::all_of(cells, Bitboard::inBounds))
+    cells = old_cells;
 
   for (auto&& cell : old_cells)
     view->setSelectionCell(ClientView::OverlayCell::NONE, cell);
@@ -160,7 +164,7 @@ void ClientControl::do_move_selection(BoardCoordinates::Transform transform) {
 
   std::cerr << "ClientControl: moved selection\n";
 
-  view->setSelection(boat.getCoordinates());
+  view->setSelection(cells);
 }
 
 void ClientControl::do_move(BoardCoordinates::Transform transform) {
@@ -168,7 +172,7 @@ void ClientControl::do_move(BoardCoordinates::Transform transform) {
   if (!view) return;
 
   ClientBoat& boat = view->getLastBoat();
-  span<BoardCoordinates> cells = boat.getCoordinates();
+  span<BoardCoordinates const> cells = boat.getCoordinates();
   vector<BoardCoordinates> old_cells(cells.begin(), cells.end());
 
   do {
@@ -180,10 +184,14 @@ void ClientControl::do_move(BoardCoordinates::Transform transform) {
     }
   } while (view->overlaps(boat));
 
-  for (auto&& cell : old_cells)
+  for (auto&& cell : old_cells) {
     view->setCell(true, cell, GameModel::CellType::WATER);
-  for (auto&& cell : cells)
+    view->setShip(true, cell, 0);
+  }
+  for (auto&& cell : cells) {
     view->setCell(true, cell, GameModel::CellType::UNDAMAGED);
+    view->setShip(true, cell, boat.getId());
+  }
 
   std::cerr << "ClientControl: moved ship\n";
 }
@@ -193,17 +201,10 @@ void ClientControl::rotate(bool orientation) {
   if (!view) return;
 
   ClientBoat& boat = view->getLastBoat();
-  span<BoardCoordinates> cells = boat.getCoordinates();
-  vector<BoardCoordinates> old_cells(cells.begin(), cells.end());
-
-  BoardCoordinates fulcrum = cells[0];
-  array<std::function<void(BoardCoordinates&)>, 2> rotations{
-   [&fulcrum](BoardCoordinates& ship_cell) { ship_cell.set(fulcrum.x() - ship_cell.y() + fulcrum.y(), fulcrum.y() - fulcrum.x() + ship_cell.x()); },
-   [&fulcrum](BoardCoordinates& ship_cell) { ship_cell.set(fulcrum.x() - fulcrum.y() + ship_cell.y(), fulcrum.y() - ship_cell.x() + fulcrum.x()); }
-  };
+  vector<BoardCoordinates> old_cells(boat.getCoordinates().begin(), boat.getCoordinates().end());
 
-  const auto& rotation = orientation ? rotations.at(0) : rotations.at(1);
-  ranges::for_each(cells | std::views::drop(1), rotation);
+  boat.rotate(orientation);
+  span<BoardCoordinates const> cells = boat.getCoordinates();
 
   if (view->overlaps(boat) || !boat.inBoundsH() || !boat.inBoundsV()) {
     std::cerr << "ClientControl: Cannot rotate\n";
@@ -211,10 +212,14 @@ void ClientControl::rotate(bool orientation) {
     return;
   }
 
-  for (auto&& cell : old_cells | std::views::drop(1))
+  for (auto&& cell : old_cells | std::views::drop(1)) {
     view->setCell(true, cell, GameModel::CellType::WATER);
-  for (auto&& cell : cells | std::views::drop(1))
+    view->setShip(true, cell, 0);
+  }
+  for (auto&& cell : cells | std::views::drop(1)) {
     view->setCell(true, cell, GameModel::CellType::UNDAMAGED);
+    view->setShip(true, cell, boat.getId());
+  }
 
   std::cerr << "ClientControl: Rotation\n";
 }
@@ -225,25 +230,9 @@ Message ClientControl::confirm() {
 
   ClientBoat& boat = view->getLastBoat();
 
-  if (view->getGamemode() == GameModel::GameMode::CLASSIC) {
-    for (BoardCoordinates ship_cell : boat.getCoordinates()) {
-      array<BoardCoordinates, 4> adjacents{ {
-        {ship_cell.x(),     ship_cell.y() - 1},  // Up
-        {ship_cell.x() - 1, ship_cell.y()},      // Left
-        {ship_cell.x(),     ship_cell.y() + 1},  // Down
-        {ship_cell.x() + 1, ship_cell.y()}       // Right
-      } };
-
-      auto is_adjacent = [this, &ship_cell, &view](BoardCoordinates adjacent) {
-        return (!(adjacent.x() >= view->width() || adjacent.y() >= view->height()) &&
-                view->getCell(view->leftTurn(), adjacent) == GameModel::CellType::UNDAMAGED &&  // Temp
-                !view->isSameShip(adjacent, ship_cell, true));
-        };
-      if (ranges::any_of(adjacents, is_adjacent)) {
-        std::cerr << "ClientControl: Adjacent to another ship" << '\n';
-        return {};
-      }
-    }
+  if (view->getGamemode() == GameModel::GameMode::CLASSIC && view->touches(boat)) {
+    std::cerr << "ClientControl: Adjacent to another ship" << '\n';
+    return {};
   }
 
   std::cerr << "ClientControl: Confirmation" << '\n';
@@ -408,7 +397,7 @@ Message ClientControl::executeFire() {
       std::cerr << "ClientControl received a valid fire target: " << position << '\n';
       return Message(GAME, Message::ClientFire(vector{position}, Basic));
     default:
-      vector<BoardCoordinates> area = chosen_ability.assembleByType(chosen_ability.getType(),position);
+      Footprint area = chosen_ability.assembleByType(chosen_ability.getType(), position);
       return Message(GAME, Message::ClientFire(area, chosen_ability.getType()));
     }
 }
@@ -539,14 +528,14 @@ void ClientControl::acceptAbility(const Message& message) {
 
 void ClientControl::acceptFire(const Message& message) {
   std::shared_ptr<ClientView> view = _view.lock();
-  auto response = message.extract<Message::ServerFire>();
+  auto response = message.extract_view<Message::ServerFire>();
 
   if (!view || !response) {
     std::cerr << "Invalid firing message\n";
     return;
   }
 
-  auto&& [new_cells, your_board, your_turn, new_energy] = response->data();
+  auto&& [new_cells, your_board, your_turn, new_energy] = *response;
 
   view->setEnergy(new_energy);
 
@@ -557,10 +546,11 @@ void ClientControl::acceptFire(const Message& message) {
     for (auto&& cell : new_cells) {
       auto&& boat = view->getBoatWith(cell.id, your_board);
       if (!boat) {
-        ClientBoat enemy_boat(Boat::Type::SENTINEL, cell.id, {cell.c});
+        ClientBoat enemy_boat(Boat::Type::SENTINEL, cell.id, vector{cell.c});
         view->pushBoat(enemy_boat, your_board);
       } else {
         boat->addCoordinate(cell.c);
+        view->setShip(your_board, cell.c, cell.id);
       }
     }
   }
@@ -10,6 +10,7 @@
 #include "../common/board_coordinates.hh"
 #include "../common/board_common.hh"
 #include "../common/ability.hh"
+#include "../common/bitboard.hh"
 #include "client_boat.hh"
 #include "client_timer.hh"
 #include "client_menu_controller.hh"
@@ -24,8 +25,8 @@ namespace NM {
 
 /** Client-side view of the game.
  *
- * Contains a grid of special characters for displaying.
- * Contains copies of server-side state. */
+ * Contains copies of server-side state, each board as bitboards: what a
+ * cell holds, or which ship, is a few bitwise operations away. */
 class ClientView : public GameModel {
  public:
   enum class OverlayCell : uint8_t {
@@ -38,8 +39,11 @@ class ClientView : public GameModel {
 
   GameStage _game_state{ (_gamemode == GameModel::GameMode::CLASSIC) ? GameStage::FACTIONSELECT : GameStage::SELECTION };
 
-  array<array<OverlayCell, BOARDSIZE>, BOARDSIZE> _overlay;
-  array<array<CellType,    BOARDSIZE>, BOARDSIZE> _view_left, _view_right;
+  using ShipGrid = array<array<int, BOARDSIZE>, BOARDSIZE>;  // Ship ids, 0 for none
+
+  Bitboard   _overlay;  // Reticle cells
+  BoardMasks _view_left, _view_right;
+  ShipGrid   _ships_left{}, _ships_right{};
   vector<BoardCoordinates> _selection{BoardCoordinates{5,5}};
 
   vector<Boat::Type> inventory;
@@ -55,6 +59,11 @@ class ClientView : public GameModel {
 
   void findFreeSpot(ClientBoat& new_boat);
 
+  /**
+   * \return Cells of every ship but the last, the one being placed.
+   */
+  [[nodiscard]] Bitboard placed() const;
+
   std::string name_you;
   std::string name_other;
   bool is_left;
@@ -63,13 +72,13 @@ public:
   ClientView(std::string_view you, std::pair<std::string, std::string> names, bool is_spectator);
   ClientView(std::string_view left, std::string_view right);
   
-  void setSelection(span<BoardCoordinates> s)   { _selection = {}; for(auto c : s) _selection.emplace_back(c); }
-  void setSelection(vector<BoardCoordinates> s) { _selection = s; }
-  void setSelectionCell(OverlayCell type, BoardCoordinates c) { _overlay[c.y()][c.x()] = type; }
-  void clearSelection() { for (auto&& row : _overlay) row.fill(OverlayCell::NONE); }
+  void setSelection(span<BoardCoordinates const> s) { _selection.assign(s.begin(), s.end()); }
+  void setSelection(vector<BoardCoordinates> s)     { _selection = s; }
+  void setSelectionCell(OverlayCell type, BoardCoordinates c) { _overlay.set(c, type == OverlayCell::RETICLE); }
+  void clearSelection() { _overlay = {}; }
   void setGamemode(GameModel::GameMode gm) { _gamemode = gm; } 
 
-  [[nodiscard]] inline vector<BoardCoordinates> getSelection() const { return _selection; }
+  [[nodiscard]] inline const vector<BoardCoordinates>& getSelection() const { return _selection; }
   [[nodiscard]] inline ClientBoat&         getLastBoat()          { return your_fleet.back(); }
   [[nodiscard]] inline GameModel::GameMode getGamemode()    const { return _gamemode; } 
   [[nodiscard]] inline Ability::Type       getLastAbility() const { return last_ability; }
@@ -77,15 +86,13 @@ public:
   [[nodiscard]] inline vector<Ability>     getAbilities()   const { return abilities; }
   [[nodiscard]] inline GameStage           gameState()      const { return _game_state; }
   [[nodiscard]] inline vector<Boat::Type>  getInventory()   const { return inventory; }
-  [[nodiscard]] inline OverlayCell         getSelectionCell(BoardCoordinates c) const { return _overlay.at(c.y()).at(c.x()); }
-  [[nodiscard]] inline CellType            getCell(bool your_side, BoardCoordinates c) const { return (your_side ?
-                                                                                            _view_left.at(c.y()).at(c.x()) :
-                                                                                            _view_right.at(c.y()).at(c.x())); }
+  [[nodiscard]] inline OverlayCell         getSelectionCell(BoardCoordinates c) const { return _overlay.test(c) ? OverlayCell::RETICLE : OverlayCell::NONE; }
+  [[nodiscard]] inline CellType            getCell(bool your_side, BoardCoordinates c) const { return (your_side ? _view_left : _view_right).at(c); }
 
   [[nodiscard]] inline bool   isFinished() const { return _is_finished; }
   [[nodiscard]] inline Victor victor()     const { return _victor; }
-  [[nodiscard]] inline size_t width()      const { return _view_left.at(0).size(); }
-  [[nodiscard]] inline size_t height()     const { return _view_left.size();       }
+  [[nodiscard]] inline size_t width()      const { return BOARDSIZE; }
+  [[nodiscard]] inline size_t height()     const { return BOARDSIZE; }
   [[nodiscard]] inline bool   leftTurn()   const { return _your_turn; }
 
   inline void setGameState(GameStage new_state)  { _game_state = new_state; }
@@ -93,16 +100,25 @@ public:
   inline void setLastAbility(Ability::Type type) { last_ability = type; }
   inline void setEnergy(int value)               { current_energy = value; }
   
-  [[nodiscard]] bool overlaps(ClientBoat& new_boat) const;
-  [[nodiscard]] bool inInventory(Boat::Type type)   const;
+  [[nodiscard]] bool overlaps(const ClientBoat& new_boat) const;
+  [[nodiscard]] bool touches(const ClientBoat& new_boat)  const;
+  [[nodiscard]] bool inInventory(Boat::Type type)         const;
   [[nodiscard]] bool isSameShip(BoardCoordinates first, BoardCoordinates second, bool your_side) const;
 
   [[nodiscard]] std::optional<int> whichShip(BoardCoordinates coordinates) const;
 
+  /**
+   * \return Id of the ship on that cell, 0 if there is none known.
+   */
+  [[nodiscard]] inline int shipAt(bool your_side, BoardCoordinates c) const {
+    return Bitboard::inBounds(c) ? (your_side ? _ships_left : _ships_right)[c.y()][c.x()] : 0;
+  }
+
   void fillInventory(GameModel::Faction faction);
   void fillAbilities(GameModel::Faction faction);  // Rework
   void addShip(Boat::Type type);
   void setCell(bool your_side, BoardCoordinates coordinate, CellType type);
+  void setShip(bool your_side, BoardCoordinates coordinate, int id);
 
   [[nodiscard]] inline epr::observer_ptr<ClientBoat> getBoatWith(int id, bool your_side) {
     auto&& fleet = your_side ? your_fleet : enemy_fleet;
@@ -111,7 +127,7 @@ public:
       return std::experimental::make_observer(&*it);
     return nullptr;
   }
-  inline void pushBoat(ClientBoat new_boat, bool your_side) { your_side ? your_fleet.push_back(new_boat) : enemy_fleet.push_back(new_boat); }
+  void pushBoat(ClientBoat new_boat, bool your_side);
 
   [[nodiscard]] auto getNames() const { return std::tuple{is_left, name_you, name_other}; }
 
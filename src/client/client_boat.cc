@@ -25,4 +25,16 @@ std::string ClientBoat::to_string() const {
 void ClientBoat::shift(BoardCoordinates::Transform transform) {
   for (auto&& coordinate : coordinates)
     coordinate += transform;
+  cells = Bitboard::of(coordinates);
+}
+
+void ClientBoat::rotate(bool clockwise) {
+  BoardCoordinates fulcrum = coordinates.front();
+  for (auto&& cell : coordinates | std::views::drop(1)) {
+    if (clockwise)
+      cell.set(fulcrum.x() - cell.y() + fulcrum.y(), fulcrum.y() - fulcrum.x() + cell.x());
+    else
+      cell.set(fulcrum.x() - fulcrum.y() + cell.y(), fulcrum.y() - cell.x() + fulcrum.x());
+  }
+  cells = Bitboard::of(coordinates);
 }
@@ -7,27 +7,27 @@
 #include "../common/board_coordinates.hh"
 #include "../common/board_common.hh"
 #include "../common/boat.hh"
+#include "../common/bitboard.hh"
 
 namespace ranges = std::ranges;
 using std::span;
 
 class ClientBoat final : public Boat {
   vector<BoardCoordinates> coordinates;
+  Bitboard cells;  // Coordinates inside the board, kept in step
 
  public:
-  ClientBoat(Type type, int id, vector<BoardCoordinates> coordinates) : Boat{type, id}, coordinates{coordinates} {}
+  ClientBoat(Type type, int id, span<BoardCoordinates const> coordinates)
+    : Boat{type, id}, coordinates(coordinates.begin(), coordinates.end()), cells{Bitboard::of(coordinates)} {}
 
   bool operator==(const ClientBoat& other) { return type == other.type && id == other.id && ranges::equal(coordinates, other.coordinates); }
 
-  [[nodiscard]] inline BoardCoordinates       origin()         { return coordinates.front(); }
-  [[nodiscard]] inline span<BoardCoordinates> getCoordinates() { return coordinates; }
+  [[nodiscard]] inline BoardCoordinates             origin()         { return coordinates.front(); }
+  [[nodiscard]] inline span<BoardCoordinates const> getCoordinates() const { return coordinates; }
+  [[nodiscard]] inline Bitboard                     mask()           const { return cells; }
 
-  [[nodiscard]] inline bool contains(BoardCoordinates c) const {
-    return ranges::find(coordinates, c) != coordinates.end();
-  }
-  [[nodiscard]] inline bool contains(const ClientBoat& other) const {
-    return ranges::any_of(other.coordinates, [this](BoardCoordinates c) { return contains(c); });
-  }
+  [[nodiscard]] inline bool contains(BoardCoordinates c)       const { return cells.test(c); }
+  [[nodiscard]] inline bool contains(const ClientBoat& other) const { return !(cells & other.cells).empty(); }
   [[nodiscard]] inline bool inBoundsH() const {
     return ranges::none_of(coordinates, [](BoardCoordinates c) { return c.x() >= BOARDSIZE; });
   }
@@ -38,7 +38,20 @@ class ClientBoat final : public Boat {
   [[nodiscard]] std::string to_string()  const;
 
   void shift(BoardCoordinates::Transform transform);
-  inline void setCoordinates(span<BoardCoordinates const> new_coordinates) { coordinates.assign(new_coordinates.begin(), new_coordinates.end()); }
+  inline void setCoordinates(span<BoardCoordinates const> new_coordinates) {
+    coordinates.assign(new_coordinates.begin(), new_coordinates.end());
+    cells = Bitboard::of(coordinates);
+  }
+
+  inline void addCoordinate(BoardCoordinates new_coordinates) {
+    coordinates.push_back(new_coordinates);
+    cells.set(new_coordinates);
+  }
 
-  inline void addCoordinate(BoardCoordinates new_coordinates) { coordinates.push_back(new_coordinates); }
+  /**
+   * Rotates a quarter turn around the first cell.
+   *
+   * \param Clockwise if true.
+   */
+  void rotate(bool clockwise);
 };
@@ -4,7 +4,6 @@
 #include <string>
 #include <span>
 #include <ranges>
-#include <fstream>
 
 #include "console_menu_display.hh"
 #include "client.hh"
@@ -49,7 +48,7 @@ void MenuControl::joinLobby(const NM::Message& message) {
 }
 
 void MenuControl::updateRelation(const NM::Message& message) {
-  if (auto relationship = message.extract<NM::Message::Relationship>())
+  if (auto relationship = message.extract_view<NM::Message::Relationship>())
     session->updateRelation(*relationship);
 }
 
@@ -82,14 +81,14 @@ void MenuControl::updateLobby(const NM::Message& message) {
 void MenuControl::updateLobbyMember(const NM::Message& message) {
   auto menu = view.lock();
   auto l = lobby.lock();
-  auto member = message.extract<NM::Message::SlotLobby>();
+  auto member = message.extract_view<NM::Message::SlotLobby>();
   if (menu && l && member)
     l->updateMember(*member);
 }
 
 void MenuControl::loadChat(const NM::Message& message) {
   auto menu = view.lock();
-  auto log = message.extract<NM::Message::ChatLog>();
+  auto log = message.extract_view<NM::Message::ChatLog>();
   if (menu && log) {
     menu->loadChat(*log);
   }
@@ -97,11 +96,11 @@ void MenuControl::loadChat(const NM::Message& message) {
 
 void MenuControl::appendChat(const NM::Message& message) {
   auto menu = view.lock();
-  auto update = message.extract<NM::Message::ChatUpdate>();
+  auto update = message.extract_view<NM::Message::ChatUpdate>();
   if (!menu || !update)
     throw std::runtime_error("Server sent invalid chat message");
 
-  menu->appendChat(*update);
+  menu->appendChat(update->sender, update->line);
 }
 
 NM::Message MenuControl::formatAuth(string_view line) const {
@@ -248,6 +247,8 @@ NM::Message MenuControl::formatChat(std::string_view line) const {
     if (line == "/q") {
       menu->setState(MenuView::MenuState::FRIENDS);
       menu->clearChat();
+    } else if (line == "/o") {
+      return loadOlderChat();
     } else {
       menu->appendChat(session->getUsername(), line);
       return NM::Message(CHAT_MESSAGE, ChatUpdate(session->getUsername(), menu->currentRecipient(), line));
@@ -256,6 +257,13 @@ NM::Message MenuControl::formatChat(std::string_view line) const {
   return {};
 }
 
+NM::Message MenuControl::loadOlderChat() const {
+  if (auto menu = view.lock())
+    if (uint64_t before = menu->askOlderChat())
+      return NM::Message(Networkable::Request::LOAD_CHAT, NM::Message::ChatLog(menu->currentRecipient(), {}, before));
+  return {};
+}
+
 NM::Message MenuControl::formatLobby(std::string_view line) const {
   if (auto menu = view.lock()) {
     auto split = line | views::split(' ');
@@ -332,7 +340,7 @@ NM::Message MenuControl::formatLobby(std::string_view line) const {
           turn_seconds = chrono::seconds(*new_turn);
         }
       }
-      return NM::Message(Networkable::Request::UPDATE_LOBBY, NM::Message::LobbyParameters({game_seconds, turn_seconds, time_type, game_type}));
+      return NM::Message(Networkable::Request::UPDATE_LOBBY, NM::Message::LobbyParameters(game_seconds, turn_seconds, time_type, game_type));
     }
 
   }
@@ -340,50 +348,53 @@ NM::Message MenuControl::formatLobby(std::string_view line) const {
   return {};
 }
 
-// Emergency
 void replayMenuLoop() {
-  std::ifstream ifs("./last.replay", std::ios::binary);
-  if (!ifs)
+  std::unique_ptr<ReplayReader> replay;
+  try {
+    replay = std::make_unique<ReplayReader>(std::string(LAST_REPLAY));
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << '\n';
     return;
-  std::vector<std::byte> bytes;
-
-  std::streampos size;
-  ifs.seekg(0, std::ios::end);
-  size = ifs.tellg();
-  ifs.seekg(0, std::ios::beg);
-
-  bytes.resize(size);
-  ifs.read(reinterpret_cast<std::ifstream::char_type *>(bytes.data()), size);
-
-  // Assume file is healthy
-  auto recording = NM::Message::Recording::from_bytes(bytes);
-  auto&& [left_name, right_name, moves] = recording.data();
+  }
+  const ReplayHeader& header = replay->header();
 
-  std::shared_ptr<ClientView>    board   = std::make_shared<ClientView>(left_name, right_name);
-  board->setGameState(GameModel::GameStage::SPECTATING);
-  board->setVictor(GameModel::Victor::REPLAY);
-  std::shared_ptr<ClientControl> control = std::make_shared<ClientControl>(board, nullptr);
-  auto game = std::make_unique<ConsoleGameDisplay>(std::cout, std::cin, board, control, nullptr);
+  std::shared_ptr<ClientView>         board;
+  std::shared_ptr<ClientControl>      control;
+  std::unique_ptr<ConsoleGameDisplay> game;
 
+  // From the keyframe before the turn, not from the first move
   size_t current_index = 0;
+  auto seek = [&](size_t turn) {
+    board = std::make_shared<ClientView>(header.left, header.right);
+    board->setGamemode(header.mode);
+    board->setGameState(GameModel::GameStage::SPECTATING);
+    board->setVictor(GameModel::Victor::REPLAY);
+    control = std::make_shared<ClientControl>(board, nullptr);
+    game    = std::make_unique<ConsoleGameDisplay>(std::cout, std::cin, board, control, nullptr);
+
+    for (const NM::Message& move : replay->seek(turn))
+      control->acceptFire(move);
+    current_index = std::min(turn, replay->turns());
+  };
+  seek(0);
+
   while (true) {
 
     game->update();
-    
-    std::cout << "> Next:  'n'\n";
 
-    string line;
-    std::getline(std::cin, line);
+    string line = game->readLine();
 
     if (line == "/q") {
       break;
-    } else if (line == "n" && current_index < moves.size()) {
-      control->acceptFire(NM::Message(Networkable::Request::GAME, std::move(moves[current_index])));
+    } else if (line == "n" && current_index < replay->turns()) {
+      control->acceptFire(replay->move(current_index));
       current_index += 1;
-    } else {
+    } else if (line == "p" && current_index > 0) {
+      seek(current_index - 1);
+    } else if (auto turn = NM::from_string(line); turn && *turn >= 0) {
+      seek(static_cast<size_t>(*turn));
+    } else if (line != "n" && line != "p") {
       break;
     }
   }
-
-
 }
@@ -59,4 +59,10 @@ class MenuControl {
   [[nodiscard]] NM::Message formatChat   (std::string_view line) const;
   [[nodiscard]] NM::Message formatLobby  (std::string_view line) const;
 
+  /**
+   * \return Request for the page of the chat before the oldest line
+   *         loaded, empty if there is none or it is on its way.
+   */
+  [[nodiscard]] NM::Message loadOlderChat() const;
+
 };
@@ -44,7 +44,7 @@ class LobbyView : public Lobby {
           right = name;
           break;
         case SPECTATOR:
-          spectators.push_back(name);
+          spectators.emplace_back(name);
           break;
         default:
           break;
@@ -56,8 +56,8 @@ class LobbyView : public Lobby {
 
   inline void clear() { *this = LobbyView(); }
 
-  void updateMember(const NM::Message::SlotLobby member) {
-    auto&& [name, slot] = member.data();
+  void updateMember(const NM::Message::SlotLobby::View member) {
+    auto&& [name, slot] = member;
     std::erase(spectators, name);
     if (name == left)
       left = "";
@@ -67,7 +67,7 @@ class LobbyView : public Lobby {
     switch (slot) {
       using enum NM::Message::SlotLobby::Slot;
       case SPECTATOR:
-        spectators.push_back(name);
+        spectators.emplace_back(name);
         break;
       case LEFT:
         left = name;
@@ -138,7 +138,9 @@ class MenuView {
   std::shared_ptr<LobbyView> lobby;
 
   string current_recipient;
-  vector<string> chat;
+  vector<string> chat;     // Loaded lines, oldest first
+  uint64_t chat_first = 0; // Number of the oldest loaded line, 0 once all are loaded
+  uint64_t chat_asked = 0; // Page last asked for, not to ask for it twice
 
  public:
   MenuView() : state{MenuState::LOGIN} {}
@@ -153,20 +155,40 @@ class MenuView {
   [[nodiscard]] inline const NM::Message::Matches& getMatches() const { return matches; }
   inline void clearBrowser() { matches.clear(); matches.shrink_to_fit(); }
 
-  void loadChat(const NM::Message::ChatLog& log) { std::tie(current_recipient, chat) = log.data(); }
+  [[nodiscard]] inline bool hasOlderChat() const { return chat_first > 0; }
+
+  /**
+   * Opens a chat on its latest page, or prepends the page right before
+   * the oldest line loaded.
+   */
+  void loadChat(const NM::Message::ChatLog::View& log) {
+    if (log.recipient == current_recipient && !chat.empty() && log.cursor + log.log.size() == chat_first) {
+      chat.insert(chat.begin(), log.log.begin(), log.log.end());
+    } else {
+      current_recipient = log.recipient;
+      chat.assign(log.log.begin(), log.log.end());
+    }
+    chat_first = log.cursor;
+  }
 
-  void appendChat(string_view name, string_view line) {
-    chat.emplace_back(string{name} + ": " + string{line});
+  /**
+   * \return Cursor to ask for the page before the oldest line loaded,
+   *         0 if there is none or it was already asked for.
+   */
+  [[nodiscard]] uint64_t askOlderChat() {
+    if (chat_first == chat_asked)
+      return 0;
+    return chat_asked = chat_first;
   }
 
-  void appendChat(const NM::Message::ChatUpdate& update) {
-    auto&& [sender, receiver, line] = update.data();
-    chat.emplace_back(sender + ": " + line);
+  void appendChat(string_view name, string_view line) {
+    chat.emplace_back(string{name} + ": " + string{line});
   }
 
   void clearChat() {
     current_recipient.clear();
     chat.clear();
+    chat_first = chat_asked = 0;
     current_recipient.shrink_to_fit();
     chat.shrink_to_fit();
   }
@@ -2,6 +2,7 @@
 
 #include <stdexcept>
 #include <iomanip>
+#include <algorithm>
 
 ClientTimer::~ClientTimer() {
   if (clock_fd != -1) close(clock_fd);
@@ -9,28 +10,39 @@ ClientTimer::~ClientTimer() {
 
 void ClientTimer::make(Type _t, chrono::seconds _limit, chrono::seconds _turn_limit) {
   t = _t;
-  seconds_game = _limit;
-  seconds_turn = _turn_limit;
-  seconds_turn_limit = _turn_limit;
+  running    = false;
+  turn_done  = false;
+  game_left  = _limit;
+  turn_left  = _turn_limit;
+  turn_limit = _turn_limit;
 }
 
 string ClientTimer::elapsed() const {
-  std::time_t time = seconds_game.count();
+  // Counted down in whole seconds, reaching 0 on the deadline
+  Clock::time_point now = Clock::now();
+  auto shown = [](Clock::duration left) {
+    std::time_t seconds = chrono::ceil<chrono::seconds>(std::max(left, Clock::duration::zero())).count();
+    return seconds;
+  };
+
+  std::time_t time = shown(running ? game_deadline - now : game_left);
   std::ostringstream oss;
   oss << std::put_time(std::gmtime(&time), "%T");
   if (t == Timer::Type::TURN) {
     oss << "\nThis turn: ";
-    std::time_t turn_time = seconds_turn.count();
+    std::time_t turn_time = shown(running ? turn_deadline - now : turn_left);
     oss << std::put_time(std::gmtime(&turn_time), "%M:%S");
   }
   return oss.str();
 }
 
 void ClientTimer::start() {
+  Clock::time_point now = Clock::now();
   running = true;
   turn_done = false;
-  seconds_turn = seconds_turn_limit;
-  setTime({ {INTERVAL}, {INTERVAL} });
+  game_deadline = now + game_left;
+  turn_deadline = now + turn_limit;
+  arm();
 }
 
 void ClientTimer::swap(bool on) {
@@ -40,25 +52,92 @@ void ClientTimer::swap(bool on) {
 }
 
 void ClientTimer::stop() {
+  if (running) {
+    Clock::time_point now = Clock::now();
+    game_left = std::max(game_deadline - now, Clock::duration::zero());
+    turn_left = std::max(turn_deadline - now, Clock::duration::zero());
+  }
   running = false;
-  setTime({ {0}, {0} });
+  setTime({ {0, 0}, {0, 0} });
+}
+
+bool ClientTimer::update() {
+  uint64_t expirations;
+  if (read(clock_fd, &expirations, sizeof(expirations)) == -1 || !running)
+    return false;  // Woken for a deadline since moved or stopped
+
+  Clock::time_point now = Clock::now();
+  if (now >= game_deadline) {
+    stop();
+    return true;
+  }
+
+  bool ran_out = false;
+  if (t == Type::TURN && !turn_done && now >= turn_deadline)
+    ran_out = turn_done = true;
+  arm();
+  return ran_out;
 }
 
-void ClientTimer::update() {
-  int64_t intervals;
-  read(clock_fd, &intervals, sizeof(int64_t));
-  seconds_game -= chrono::seconds(intervals);
-  if (t == Timer::Type::TURN)
-    seconds_turn -= chrono::seconds(intervals);
-  if (0 >= seconds_turn.count())
-    turn_done = true;
-  if (0 >= seconds_game.count())
-    running = false;
+void ClientTimer::arm() {
+  // Next time a countdown shown loses a second, which is also when it reaches 0
+  Clock::time_point now = Clock::now();
+  auto change = [now](Clock::time_point deadline) {
+    return deadline <= now ? now : deadline - chrono::ceil<chrono::seconds>(deadline - now) + chrono::seconds(1);
+  };
+
+  Clock::time_point next = change(game_deadline);
+  if (t == Type::TURN && !turn_done)
+    next = std::min(next, change(turn_deadline));
+
+  auto since = next.time_since_epoch();
+  auto whole = chrono::floor<chrono::seconds>(since);
+  itimerspec time{ {0, 0}, {0, 0} };
+  time.it_value.tv_sec  = whole.count();
+  time.it_value.tv_nsec = (since - whole).count();
+  if (time.it_value.tv_sec == 0 && time.it_value.tv_nsec == 0)
+    time.it_value.tv_nsec = 1;  // Zero would disarm it
+  setTime(time, TFD_TIMER_ABSTIME);
 }
 
-void ClientTimer::setTime(const itimerspec& time) {
-  if (timerfd_settime(clock_fd, 0, &time, NULL) == -1) {
+NM::Message ClientTimer::probe() {
+  probes     = 0;
+  round_trip = Clock::duration::max();
+  return NM::Message(Networkable::Request::CLOCK, NM::Message::ClockSync(toWire(Clock::now())));
+}
+
+NM::Message ClientTimer::acceptClock(const NM::Message& message) {
+  Clock::time_point now = Clock::now();
+
+  if (auto sync = message.extract<NM::Message::ClockSync>()) {
+    auto&& [sent, answered] = sync->data();
+    if (answered == chrono::microseconds::zero() || fromWire(sent) > now)
+      return {};
+
+    // The server answered halfway through the round trip, as far as we can tell
+    Clock::duration trip = now - fromWire(sent);
+    if (trip < round_trip) {
+      round_trip = trip;
+      offset     = fromWire(answered) - (fromWire(sent) + trip / 2);
+    }
+    if (++probes < PROBES)
+      return NM::Message(Networkable::Request::CLOCK, NM::Message::ClockSync(toWire(now)));
+    return {};
+  }
+
+  if (auto deadline = message.extract<NM::Message::Deadline>(); deadline && running) {
+    auto&& [game, turn] = deadline->data();
+    game_deadline = fromWire(game) - offset;
+    if (turn != chrono::microseconds::zero())
+      turn_deadline = fromWire(turn) - offset;
+    arm();
+  }
+  return {};
+}
+
+void ClientTimer::setTime(const itimerspec& time, int flags) {
+  if (timerfd_settime(clock_fd, flags, &time, NULL) == -1) {
     close(clock_fd);
     clock_fd = -1;
   }
-}
\ No newline at end of file
+}
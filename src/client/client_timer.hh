@@ -6,14 +6,25 @@
 #include <chrono>
 
 #include "../common/timer.hh"
+#include "../common/serializer.hh"
 
 namespace chrono = std::chrono;
 using std::string;
 
+/**
+ * Game and turn countdowns, kept as deadlines on the monotonic clock and
+ * read on demand. The timer descriptor only wakes the client when a
+ * countdown shown changes or runs out, and nothing at all while stopped.
+ *
+ * The server enforces the same deadlines by its own clock: it sends them
+ * with each turn, converted here with the offset measured by ClockSync
+ * probes, so both sides run out together.
+ */
 class ClientTimer : public Timer {
  public:
+  // steady_clock reads CLOCK_MONOTONIC, so deadlines arm the descriptor as they are
   ClientTimer() : Timer{Timer::Type::GLOBAL}, turn_done{false} {
-    if ((clock_fd = timerfd_create(CLOCK_REALTIME, 0)) == -1) {
+    if ((clock_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK)) == -1) {
       return;
     }
   }
@@ -30,17 +41,47 @@ class ClientTimer : public Timer {
   void start();
   void swap(bool on);
   void stop();
-  void update();
+
+  /**
+   * Reads the descriptor and checks the deadlines against the clock.
+   *
+   * \return Whether one was just reached, once per deadline.
+   */
+  bool update();
+
+  /**
+   * Starts measuring the offset to the server's clock anew, as both
+   * drift apart over a long session.
+   *
+   * \return First probe to send.
+   */
+  [[nodiscard]] NM::Message probe();
+
+  /**
+   * Takes the answer to a probe, or the deadlines of a turn starting,
+   * which replace the ones counted from when the move was received.
+   *
+   * \param CLOCK message from the server.
+   * \return Next probe to send, empty once enough were.
+   */
+  [[nodiscard]] NM::Message acceptClock(const NM::Message& message);
 
  private:
-  static constexpr int INTERVAL = 1;
-  
+  static constexpr size_t PROBES = 4;  // The one with the shortest round trip is kept
+
   int clock_fd;
   bool turn_done;
 
-  chrono::seconds seconds_game;
-  chrono::seconds seconds_turn;
-  chrono::seconds seconds_turn_limit;
+  chrono::seconds turn_limit;
+  Clock::duration game_left;  // While stopped
+  Clock::duration turn_left;
+  Clock::time_point game_deadline;  // While running
+  Clock::time_point turn_deadline;
+
+  size_t probes = 0;
+  Clock::duration round_trip = Clock::duration::max();
+  Clock::duration offset{};  // Server's clock minus ours
 
-  void setTime(const itimerspec& time);
-};
\ No newline at end of file
+  void arm();
+  void setTime(const itimerspec& time, int flags = 0);
+};
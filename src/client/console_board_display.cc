@@ -102,7 +102,8 @@ vector<string> ConsoleGameDisplay::createGrid(bool my_side) const {
         oss << border << NM::setc{Color::GREEN} << "█" << NM::setc{};
       } else {
         GameModel::CellType content  = _board->getCell(my_side, {j, i});
-        bool check = (j > 0 && _board->isSameShip({j, i}, {j - 1, i}, my_side));
+        int ship   = _board->shipAt(my_side, {j, i});
+        bool check = (j > 0 && ship != 0 && ship == _board->shipAt(my_side, {j - 1, i}));
         if (check) {
           GameModel::CellType previous = _board->getCell(my_side, {j - 1, i});
           auto b = best(content, previous);
@@ -223,15 +224,10 @@ ConsoleGameDisplay::ConsoleGameDisplay(std::ostream& out, std::istream& in,
     selection_legend{createAttackSelectionLegend()} {}
 
 Message ConsoleGameDisplay::handleInput() {
-  string line;
-  std::getline(std::cin, line);
+  string line = readLine();
 
-
-#ifndef GUI
-  first_refresh = true;
-#endif
-  if (std::cin.eof()) {
-    output << std::endl;
+  if (input.eof()) {
+    terminal << std::endl;
     _control->quit();
     return {};
   }
@@ -267,18 +263,6 @@ Message ConsoleGameDisplay::handleInput() {
 }
 
 void ConsoleGameDisplay::update() {
-#ifndef GUI
-  if (!first_refresh && timer) {
-    output << "\033[s";
-    output << '\r';
-    output << "\033[29C";
-    output << "\033[1J";
-    output << "\033[H";
-  } else {
-    std::system("clear");  // Don't touch this either
-  }
-#endif
-
   if (_board->gameState() != GameModel::GameStage::SPECTATING)
     output << "Time remaining: " << timer->elapsed() << "\n\n";
   
@@ -322,14 +306,12 @@ void ConsoleGameDisplay::update() {
       default:
         throw NotImplementedError("Game stage not implemented: 312 csb");
     }
-#ifndef GUI
-  if (!first_refresh && timer)
-    output << "\033[u";
 
   if (_board->isFinished())
     output << "\n> Leave: '/q'\n";
-  output << std::flush;
-
-  first_refresh = false;
-#endif
+  if (_board->victor() == GameModel::Victor::REPLAY)
+    output << "> Next:  'n'\n"
+           << "> Back:  'p'\n"
+           << "> Turn:  its number\n";
+  present();
 }
@@ -2,6 +2,12 @@
 
 #include <string>
 #include <algorithm>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <unistd.h>
+
+#include "frame_buffer.hh"
 
 /**
  * Repeats any string-like by the given amount.
@@ -16,6 +22,17 @@
 }
 
 class ConsoleDisplay {
+ public:
+  /**
+   * Reads a line typed at the prompt, which the terminal echoed.
+   */
+  std::string readLine() {
+    std::string line;
+    std::getline(input, line);
+    screen().echoed();
+    return line;
+  }
+
  protected:
   [[nodiscard]] static constexpr size_t length(std::string_view s) {
     // In UTF-8, continuation bytes begin with 0b10, so, does not count these bytes.
@@ -23,8 +40,28 @@ class ConsoleDisplay {
         std::ranges::count_if(s, [](char c) noexcept { return (c & '\xC0') != '\x80'; }));
   }
 
-  std::ostream& output;
+  /**
+   * The terminal, shared by every display drawing on it.
+   */
+  static FrameBuffer& screen() {
+    static FrameBuffer terminal{STDOUT_FILENO};
+    return terminal;
+  }
+
+  std::ostringstream frame;
+  std::ostream& terminal;
+  std::ostream& output;  // Frame being composed, shown by present()
   std::istream& input;
 
-  ConsoleDisplay(std::ostream& out, std::istream& in) : output{out}, input{in} {}
+  ConsoleDisplay(std::ostream& out, std::istream& in) : terminal{out}, output{frame}, input{in} {}
+
+  /**
+   * Shows the frame composed in output, repainting only what changed,
+   * and starts the next one.
+   */
+  void present() {
+    terminal.flush();  // Anything printed around displays comes first
+    screen().present(frame.view());
+    frame.str({});
+  }
 };
@@ -78,6 +78,7 @@ void ConsoleMenuDisplay::displayFriends() const {
 void ConsoleMenuDisplay::displayChat() const {
   output
     << "============ Chat Menu ============\n"
+    << (menu->hasOlderChat() ? "> Older messages: '/o'\n" : "")
     << NM::print_range{menu->currentChat()} << "\n"
     << "> Exit chat: '/q'\n";
 }
@@ -109,8 +110,6 @@ ConsoleMenuDisplay::ConsoleMenuDisplay(std::ostream& out, std::istream& in,
     ConsoleDisplay{out, in} {}
 
 void ConsoleMenuDisplay::display() {
-  std::system("clear");  // Don't touch this
-
   switch(menu->currentState()) {
     using enum MenuView::MenuState;
     case LOGIN:
@@ -134,12 +133,12 @@ void ConsoleMenuDisplay::display() {
     default:
       throw std::runtime_error("MenuDisplay reached unreachable case in display()");
   }
-  output << ">> " << std::flush;
+  output << ">> ";
+  present();
 }
 
 NM::Message ConsoleMenuDisplay::handleInput() {
-  string line;
-  std::getline(std::cin, line);
+  string line = readLine();
 
   if (line.empty()) return {};
 
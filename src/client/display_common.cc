@@ -60,10 +60,59 @@ void MenuDisplay::handleServer(const NM::Message& message) {
   }
 }
 
+void GameDisplay::record(std::string path) {
+  auto&& [is_left, you, other] = _board->getNames();
+  if (_board->gameState() != GameModel::GameStage::SPECTATING)
+    seat = is_left ? 0 : 1;
+
+  ReplayHeader header{is_left ? you : other, is_left ? other : you, _board->getGamemode(), {}};
+  if (header.mode == GameModel::GameMode::CLASSIC)
+    header.factions = {GameModel::Faction::CLASSIC, GameModel::Faction::CLASSIC};
+
+  replay_path = std::move(path);
+  replay = std::make_unique<ReplayWriter>(replay_path, header);
+}
+
+void GameDisplay::recordMove(const NM::Message& message) {
+  if (!replay)
+    return;
+
+  if (auto faction = message.extract<NM::Message::Faction>()) {
+    if (seat)
+      replay->setFaction(*seat, faction->data());
+  } else if (auto move = message.extract_view<NM::Message::ServerFire>()) {
+    // Spectators see the left player's side as theirs
+    replay->append(move->your_board == (seat != 1), move->cells);
+  }
+}
+
+void GameDisplay::recordEnd(const NM::Message& message) {
+  auto recording = message.extract<NM::Message::Recording>();
+  if (!replay || !recording)
+    return;
+
+  auto&& moves = std::get<2>(recording->data());
+  if (replay->turns() != moves.size() || replay->digest() != ReplayWriter::digest(*recording)) {
+    // Missed a move, so the server's recording is written over it
+    ReplayHeader header = replay->header();
+    replay = nullptr;
+    replay = std::make_unique<ReplayWriter>(replay_path, header);
+    for (auto&& move : moves) {
+      auto&& [cells, left_board, turn, energy] = move.data();
+      replay->append(left_board, cells);
+    }
+  }
+  replay->finish();
+  replay = nullptr;
+}
+
 void GameDisplay::handleServer(const NM::Message& message) {
-#ifndef GUI
-  first_refresh = true;
-#endif
+  if (message.request() == Networkable::Request::RECORDING) {
+    recordEnd(message);
+    return;
+  }
+  if (message.request() == Networkable::Request::GAME)
+    recordMove(message);
 
   if (message.request() == Networkable::Request::GAMEOVER) {
       _control->endGame(message);
@@ -8,6 +8,7 @@
 #include "client_menu_view.hh"
 #include "client_timer.hh"
 #include "client_board.hh"
+#include "replay.hh"
 
 using std::experimental::observer_ptr;
 
@@ -42,9 +43,13 @@ class GameDisplay {
   std::shared_ptr<ClientControl>    const _control;
   epr::observer_ptr<ClientTimer const>     timer;
 
-#ifndef GUI
-  bool first_refresh = true;
-#endif
+ private:
+  std::string replay_path;
+  std::unique_ptr<ReplayWriter> replay;
+  std::optional<size_t> seat;  // 0 on the left, none when spectating
+
+  void recordMove(const NM::Message& message);
+  void recordEnd(const NM::Message& message);
 
  public:
   GameDisplay(std::shared_ptr<ClientView const> board,
@@ -52,5 +57,14 @@ class GameDisplay {
               ClientTimer* timer)
     : _board{std::move(board)}, _control{std::move(control)}, timer{timer} {}
 
+  /**
+   * Streams the match to a replay file as it is played, moves seen as
+   * spectators see them. The recording sent once it is over is checked
+   * against it, and rewrites it if any move was missed.
+   *
+   * \param Path of the replay file.
+   */
+  void record(std::string path);
+
   void handleServer(const NM::Message& message);
 };
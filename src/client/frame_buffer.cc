@@ -0,0 +1,243 @@
+#include "frame_buffer.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <limits>
+#include <unistd.h>
+
+namespace {
+  constexpr size_t NOWHERE = std::numeric_limits<size_t>::max();
+
+  /**
+   * \return Length of the UTF-8 sequence starting with that byte.
+   */
+  constexpr size_t sequence(char lead) {
+    auto byte = static_cast<unsigned char>(lead);
+    if ((byte & 0xE0) == 0xC0) return 2;
+    if ((byte & 0xF0) == 0xE0) return 3;
+    if ((byte & 0xF8) == 0xF0) return 4;
+    return 1;
+  }
+
+  void append(std::string& out, size_t number) {
+    char digits[std::numeric_limits<size_t>::digits10 + 1];
+    auto [end, _] = std::to_chars(std::begin(digits), std::end(digits), number);
+    out.append(digits, end);
+  }
+}
+
+FrameBuffer::FrameBuffer(int fd) : fd{fd} {}
+
+//                   ╔═════════╗
+//                   ║ Parsing ║
+//                   ╚═════════╝
+
+FrameBuffer::Position FrameBuffer::parse(std::string_view frame) {
+  Position at;
+  uint8_t foreground = DEFAULT_FG, background = DEFAULT_BG;
+
+  next_rows = 0;
+  auto row = [&]() -> Row& {
+    for (; next_rows <= at.row; ++next_rows) {
+      if (next.size() == next_rows)
+        next.emplace_back();
+      next[next_rows].clear();
+    }
+    return next[at.row];
+  };
+  row();
+
+  for (size_t i = 0; i < frame.size();) {
+    char c = frame[i];
+
+    if (c == '\033' && i + 1 < frame.size() && frame[i + 1] == '[') {
+      // Control sequence: parameters, then a final byte; only colours matter
+      size_t end = frame.find_first_of("@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~", i + 2);
+      if (end == std::string_view::npos)
+        break;
+      if (frame[end] == 'm') {
+        std::string_view parameters = frame.substr(i + 2, end - i - 2);
+        do {
+          unsigned code = 0;
+          std::from_chars(parameters.data(), parameters.data() + parameters.size(), code);
+          if (code == 0) {
+            foreground = DEFAULT_FG;
+            background = DEFAULT_BG;
+          } else if ((30 <= code && code <= 39) || (90 <= code && code <= 97)) {
+            foreground = static_cast<uint8_t>(code);
+          } else if ((40 <= code && code <= 49) || (100 <= code && code <= 107)) {
+            background = static_cast<uint8_t>(code);
+          }
+          size_t separator = parameters.find(';');
+          parameters.remove_prefix(separator == std::string_view::npos ? parameters.size() : separator + 1);
+        } while (!parameters.empty());
+      }
+      i = end + 1;
+      continue;
+    }
+
+    if (c == '\n') {
+      ++at.row;
+      at.column = 0;
+      row();
+      ++i;
+      continue;
+    }
+    if (c == '\r') {
+      at.column = 0;
+      ++i;
+      continue;
+    }
+    if (static_cast<unsigned char>(c) < ' ') {
+      ++i;
+      continue;
+    }
+
+    Cell cell{{}, foreground, background};
+    size_t length = std::min({sequence(c), frame.size() - i, cell.glyph.size()});
+    std::copy_n(frame.begin() + static_cast<std::ptrdiff_t>(i), length, cell.glyph.begin());
+    i += length;
+
+    Row& current = row();
+    if (current.size() <= at.column)
+      current.resize(at.column + 1);
+    current[at.column++] = cell;
+  }
+
+  return at;
+}
+
+//                   ╔════════════╗
+//                   ║ Presenting ║
+//                   ╚════════════╝
+
+void FrameBuffer::present(std::string_view frame) {
+  Position end = parse(frame);
+
+  out.clear();
+  cursor      = {NOWHERE, NOWHERE};
+  size_t from = NOWHERE;  // Rows from which the terminal shows something else than what was sent
+  bool keep   = false;    // Whether a line is being typed after the prompt, which must stay
+
+  if (!painted) {
+    out += "\033[0m\033[H\033[2J";
+    cursor     = {0, 0};
+    fg         = DEFAULT_FG;
+    bg         = DEFAULT_BG;
+    shown_rows = 0;
+    painted    = true;
+  } else if (typed) {
+    from = prompt.row;
+  } else if (end == prompt) {
+    keep = true;
+    out += "\033[s";  // Saves the cursor, wherever the user is typing
+  } else {
+    from = prompt.row;
+  }
+  typed = false;
+  size_t untouched = out.size();
+
+  const Cell blank;
+  for (size_t r = 0; r < next_rows; ++r) {
+    const Row& now    = next[r];
+    const Row* before = r < shown_rows ? &shown[r] : nullptr;
+
+    if (r >= from) {
+      moveTo({r, 0});
+      style(DEFAULT_FG, DEFAULT_BG);
+      eraseLine();
+      before = nullptr;
+    }
+
+    for (size_t c = 0; c < now.size(); ++c) {
+      const Cell& was = before && c < before->size() ? (*before)[c] : blank;
+      if (now[c] != was) {
+        moveTo({r, c});
+        draw(now[c]);
+      }
+    }
+
+    if (before && before->size() > now.size()
+        && std::any_of(before->begin() + static_cast<std::ptrdiff_t>(now.size()), before->end(),
+                       [&blank](const Cell& cell) { return cell != blank; })) {
+      moveTo({r, now.size()});
+      style(DEFAULT_FG, DEFAULT_BG);
+      eraseLine();
+    }
+  }
+
+  if (shown_rows > next_rows || from != NOWHERE) {
+    // Rows the frame no longer has, or what was typed below it
+    moveTo({next_rows, 0});
+    style(DEFAULT_FG, DEFAULT_BG);
+    eraseBelow();
+  }
+  style(DEFAULT_FG, DEFAULT_BG);
+
+  if (keep && out.size() == untouched)
+    out.clear();  // Nothing changed
+  else if (keep)
+    out += "\033[u";
+  else
+    moveTo(end);
+
+  std::swap(shown, next);
+  shown_rows = next_rows;
+  prompt     = end;
+  flush();
+}
+
+void FrameBuffer::moveTo(Position position) {
+  if (cursor == position)
+    return;
+  out += "\033[";
+  append(out, position.row + 1);
+  out += ';';
+  append(out, position.column + 1);
+  out += 'H';
+  cursor = position;
+}
+
+void FrameBuffer::style(uint8_t foreground, uint8_t background) {
+  if (foreground == fg && background == bg)
+    return;
+  out += "\033[";
+  append(out, foreground);
+  out += ';';
+  append(out, background);
+  out += 'm';
+  fg = foreground;
+  bg = background;
+}
+
+void FrameBuffer::draw(const Cell& cell) {
+  style(cell.fg, cell.bg);
+  for (char byte : cell.glyph) {
+    if (byte == '\0')
+      break;
+    out += byte;
+  }
+  ++cursor.column;
+}
+
+void FrameBuffer::eraseLine() {
+  out += "\033[K";
+}
+
+void FrameBuffer::eraseBelow() {
+  out += "\033[J";
+}
+
+void FrameBuffer::flush() {
+  std::string_view rest = out;
+  while (!rest.empty()) {
+    ssize_t written = ::write(fd, rest.data(), rest.size());
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return;  // The terminal is gone, nothing to show anything on
+    }
+    rest.remove_prefix(static_cast<size_t>(written));
+  }
+}
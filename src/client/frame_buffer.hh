@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * What the terminal shows, cell by cell, to repaint only what changed.
+ *
+ * A frame is text as it would be printed: lines, UTF-8 glyphs of one
+ * column each, and NM::setc colours. Presenting one compares it to the
+ * last, then sends cursor moves and the glyphs that differ in a single
+ * write. The cursor is left where the frame's text ends, for the prompt.
+ */
+class FrameBuffer {
+ public:
+  /**
+   * \param File descriptor of the terminal.
+   */
+  explicit FrameBuffer(int fd);
+
+  /**
+   * Brings the terminal to show the frame.
+   *
+   * \param Frame to show, its text as it would be printed.
+   */
+  void present(std::string_view frame);
+
+  /**
+   * The terminal echoed a line typed at the prompt, and the cursor moved
+   * past it: rows from the prompt's down are no longer what was sent.
+   */
+  void echoed() { typed = true; }
+
+  /**
+   * Makes the next frame repaint the whole screen.
+   */
+  void invalidate() { painted = false; }
+
+  FrameBuffer(FrameBuffer&&)      = delete;
+  FrameBuffer(const FrameBuffer&) = delete;
+
+ private:
+  static constexpr uint8_t DEFAULT_FG = 39;
+  static constexpr uint8_t DEFAULT_BG = 49;
+
+  struct Cell {
+    std::array<char, 4> glyph{' '};  // UTF-8, unused bytes are 0
+    uint8_t fg = DEFAULT_FG;
+    uint8_t bg = DEFAULT_BG;
+
+    bool operator==(const Cell&) const = default;
+  };
+
+  struct Position {
+    size_t row = 0, column = 0;
+
+    bool operator==(const Position&) const = default;
+  };
+
+  using Row = std::vector<Cell>;
+
+  int fd;
+  std::vector<Row> shown, next;  // Rows are kept, and reused, once grown
+  size_t shown_rows = 0, next_rows = 0;
+  Position prompt;               // Where the last frame left the cursor
+  bool painted = false;
+  bool typed   = false;
+
+  std::string out;               // Escape sequences of the frame being presented
+  Position cursor;               // Of the terminal, while presenting
+  uint8_t fg = DEFAULT_FG, bg = DEFAULT_BG;
+
+  /**
+   * Splits the frame into cells, in next.
+   *
+   * \return Where the frame's text ends.
+   */
+  Position parse(std::string_view frame);
+
+  void moveTo(Position position);
+  void style(uint8_t foreground, uint8_t background);
+  void draw(const Cell& cell);
+  void eraseLine();   // From the cursor to the end of its row
+  void eraseBelow();  // From the cursor to the end of the screen
+  void flush();
+};
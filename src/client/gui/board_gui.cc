@@ -5,24 +5,63 @@
 #pragma GCC diagnostic ignored "-Wnarrowing"  // Wontfix
 
 
-Board::Board(sf::Vector2f coords, sf::Vector2f cellSize, sf::Font* font, std::shared_ptr<ClientView const> model, std::shared_ptr<ClientControl>  control, bool your_board, unsigned int size) : /*boats(boats),*/ font(font),_model(model), _control(control), your_board(your_board) {
+namespace {
+  constexpr float BORDER = 2;
+  constexpr float PITCH  = 50;  // Between cells
+
+  /**
+   * Appends a rectangle, as the two triangles of the vertex array.
+   */
+  void appendQuad(sf::VertexArray& array, sf::FloatRect rect, sf::Color color, sf::FloatRect texture = {}) {
+    sf::Vector2f corners[4] = {{rect.left, rect.top}, {rect.left + rect.width, rect.top},
+                               {rect.left + rect.width, rect.top + rect.height}, {rect.left, rect.top + rect.height}};
+    sf::Vector2f uv[4]      = {{texture.left, texture.top}, {texture.left + texture.width, texture.top},
+                               {texture.left + texture.width, texture.top + texture.height}, {texture.left, texture.top + texture.height}};
+    for (int corner : {0, 1, 2, 0, 2, 3})
+      array.append(sf::Vertex(corners[corner], color, uv[corner]));
+  }
+
+  void colourQuad(sf::VertexArray& array, size_t quad, sf::Color color) {
+    for (size_t vertex = 0; vertex < 6; ++vertex)
+      array[quad * 6 + vertex].color = color;
+  }
+}
+
+Board::Board(sf::Vector2f coords, sf::Vector2f cellSize, sf::Font* font, std::shared_ptr<ClientView const> model, std::shared_ptr<ClientControl>  control, bool your_board, unsigned int size) : /*boats(boats),*/ font(font), origin(coords.x + PITCH, coords.y), cell_size(cellSize), _model(model), _control(control), your_board(your_board) {
   for (size_t x = 0; x < BOARDSIZE; x++) {
     for (size_t y = 0; y < BOARDSIZE; y++) {
       board[x][y] = {sf::Vector2f(coords.x + (x + 1) * 50,coords.y + (y) * 50),cellSize,sf::Vector2i(x,y), model,control};  //modify position after
     }
   }
+
+  // Cells leave a border's width uncovered on their right and bottom, showing the grid
+  appendQuad(grid, {origin.x - BORDER, origin.y - BORDER, BOARDSIZE * PITCH + BORDER, BOARDSIZE * PITCH + BORDER}, sf::Color::Black);
+  for (size_t x = 0; x < BOARDSIZE; x++)
+    for (size_t y = 0; y < BOARDSIZE; y++) {
+      appendQuad(cells, {origin.x + x * PITCH, origin.y + y * PITCH, cellSize.x - BORDER, cellSize.y - BORDER}, sf::Color::Transparent);
+      shown[x][y] = sf::Color::Transparent;  // Coloured on first display
+    }
+}
+
+void Board::buildLabels() {
   std::string letters = "ABCDEFGHIJ";
-  sf::Text text;
+  auto write = [this](std::string text, sf::Vector2f position) {
+    float x = position.x;
+    uint32_t previous = 0;
+    for (char c : text) {
+      const sf::Glyph& glyph = font->getGlyph(c, LABEL_SIZE, false);
+      x += font->getKerning(previous, c, LABEL_SIZE);
+      previous = c;
+      sf::FloatRect texture(glyph.textureRect);
+      appendQuad(labels, {x + glyph.bounds.left, position.y + LABEL_SIZE + glyph.bounds.top, glyph.bounds.width, glyph.bounds.height},
+                 sf::Color::White, texture);
+      x += glyph.advance;
+    }
+  };
+  sf::Vector2f coords{origin.x - PITCH, origin.y};
   for (int i = 0; i < 10; i++) {
-    text.setString(letters[i]);
-    text.setFont(*font);
-    text.setCharacterSize(20);
-    text.setFillColor(sf::Color::White);
-    text.setPosition({coords.x + cellSize.x + cellSize.x / 4 + (i) * 50,coords.y - 40});
-    board_text.push_back(text);
-    text.setString(std::to_string(i + 1));
-    text.setPosition({coords.x + 20,coords.y + cellSize.y / 4 + (i) * 50});
-    board_text.push_back(text);
+    write(std::string(1, letters[i]), {coords.x + cell_size.x + cell_size.x / 4 + (i) * 50, coords.y - 40});
+    write(std::to_string(i + 1), {coords.x + 20, coords.y + cell_size.y / 4 + (i) * 50});
   }
 }
 
@@ -35,13 +74,22 @@ void Board::update(const sf::Vector2f mousePos, bool& click) {
 }
 
 void Board::display(std::shared_ptr<sf::RenderWindow> window) {
+  if (labels.getVertexCount() == 0)
+    buildLabels();
+
   for (size_t x = 0; x < BOARDSIZE; x++) {
     for (size_t y = 0; y < BOARDSIZE; y++) {
-      board[x][y].display(window);
+      sf::Color color = board[x][y].getColor();
+      if (color != shown[x][y]) {
+        colourQuad(cells, x * BOARDSIZE + y, color);
+        shown[x][y] = color;
+      }
     }
   }
-  for (auto& m : board_text)
-    window->draw(m);
+
+  window->draw(grid);
+  window->draw(cells);
+  window->draw(labels, &font->getTexture(LABEL_SIZE));
 }
 
 void Board::placeBoats(const sf::Vector2f mousePos, bool& click) {
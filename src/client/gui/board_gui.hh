@@ -7,10 +7,23 @@
 
 using std::vector;
 
+/**
+ * Both the cells and the labels are drawn as a few vertex arrays, one
+ * draw call each, rather than a shape or a text per cell: the cells'
+ * colours are only written again where they changed, and the labels take
+ * their glyphs from the font's own texture.
+ */
 class Board {
+  static constexpr unsigned LABEL_SIZE = 20;
+
   array<array<Cell,BOARDSIZE>,BOARDSIZE> board;
-  vector<sf::Text> board_text;
   sf::Font *font;
+  sf::Vector2f origin;                                    // Of the first cell
+  sf::Vector2f cell_size;
+  sf::VertexArray grid{sf::Triangles};                    // Lines between cells, under them
+  sf::VertexArray cells{sf::Triangles};                   // One quad per cell, x major
+  sf::VertexArray labels{sf::Triangles};                  // Built on first display, once the font is loaded
+  array<array<sf::Color,BOARDSIZE>,BOARDSIZE> shown;      // Colours in cells
   std::shared_ptr<ClientView const> const _model;
   std::shared_ptr<ClientControl> const _control;
   GameModel::GameStage game_state = GameModel::GameStage::PLACEMENT;
@@ -31,4 +44,7 @@ class Board {
   GameModel::CellType getLastCellSelected();
   void updateGUI();
 
+ private:
+  void buildLabels();
+
 };
@@ -32,5 +32,6 @@ class Cell {
   void setColors();
   void setType(GameModel::CellType newType){type = newType; setColors(); cell.setColors(color,hoverColor,pressedColor);}
   GameModel::CellType getType(){return type;}
+  sf::Color getColor(){return cell.getFillColor();}
 
 };
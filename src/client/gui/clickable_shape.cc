@@ -43,6 +43,10 @@ sf::RectangleShape ClickableShape::getShape() {
   return shape;
 }
   
+sf::Color ClickableShape::getFillColor() {
+  return shape.getFillColor();
+}
+
 short unsigned ClickableShape::getState() {
   return state;
 }
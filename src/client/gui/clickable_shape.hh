@@ -41,6 +41,7 @@ class ClickableShape {
     bool isPressed();
     bool containsWithoutBorder(const sf::Vector2f mousePos);
     sf::RectangleShape getShape();
+    sf::Color getFillColor();
     short unsigned getState();
     void setPosition(sf::Vector2f coords);
     void setColors(sf::Color newIdle, sf::Color newHover, sf::Color newPressed);
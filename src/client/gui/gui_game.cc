@@ -14,6 +14,7 @@ NM::Message GUIGame::pollEvent() {
     res = updateButtonPressed(index);
 
   while (window->pollEvent(ev)) {
+    changed = true;
     switch(ev.type) {
       case sf::Event::Closed:
         window->close();
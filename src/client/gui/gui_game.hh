@@ -79,6 +79,7 @@ class GUIGame : public GameDisplay {
 
  public: 
   bool is_active = 1;
+  bool changed   = 1;  // Since the last display(), by input or the server
 
   GUIGame(std::shared_ptr<sf::RenderWindow> window, std::shared_ptr<ClientView const> board, std::shared_ptr<ClientControl> control,
                      ClientTimer* timer, bool mode = 0, std::ostream& out = std::cout, std::istream& in = std::cin)
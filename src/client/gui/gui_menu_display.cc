@@ -34,6 +34,7 @@ NM::Message GUIMenuDisplay::pollEvent() {
     res = updateButtonPressed();
   sf::Event event;
   while(window->pollEvent(event)) {
+    changed = true;
     switch(event.type) {
       case sf::Event::Closed:
         window->close();
@@ -523,6 +524,13 @@ NM::Message GUIMenuDisplay::updateButtonPressed() {
     join.clear();
   }
 
+  // Older lines are asked for once the thumb is dragged to the top
+  if (screenState == CHAT && scrollbarChat.isPressed() && scrollbarChat.getPosThumb().y <= scrollbarChat.getPosTrack().y) {
+    NM::Message older = control->loadOlderChat();
+    if (!older.empty())
+      return older;
+  }
+
   if (quitChat.isPressed()) {
     NM::Message ret = control->formatChat("/q");
     screenState = MAINMENU;
@@ -23,6 +23,7 @@ inline int WINDOW_HEIGHT = 1000;
 class GUIMenuDisplay : public MenuDisplay {                      
  public: 
   bool is_active = 1;
+  bool changed   = 1;  // Since the last display(), by input or the server
   GUIMenuDisplay(std::shared_ptr<sf::RenderWindow> window, std::shared_ptr<MenuView const>  view, std::shared_ptr<MenuControl> control,
                  std::shared_ptr<LobbyView const> lobby, observer_ptr<SessionInfo const> session);
   
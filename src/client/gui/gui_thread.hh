@@ -1,11 +1,17 @@
 ﻿#pragma once
 
+#include <chrono>
+#include <deque>
+#include <semaphore>
 #include <thread>
 #include <functional>
+#include <sys/eventfd.h>
 #include <unistd.h>
+#include <vector>
 
 #include "gui_game.hh"
 #include "gui_menu_display.hh"
+#include "../../common/spsc_queue.hh"
 
 struct menu_data_t {
   std::shared_ptr<MenuView  const> const view;
@@ -15,30 +21,129 @@ struct menu_data_t {
   ClientTimer* timer;
 };
 
+/**
+ * Window of the client, on a thread of its own. Nothing is shared with
+ * the network thread but two lock-free queues: server messages are
+ * handed over and applied on this thread, and messages to send come back
+ * through an eventfd the network thread polls next to its socket. The
+ * timer is only touched here once the thread runs, CLOCK messages included.
+ *
+ * The window is only redrawn when a server message or input changed
+ * something; otherwise the thread sleeps until either comes, a frame at
+ * most, since SFML events cannot be waited on together with anything.
+ */
 class GUIThread {
+  static constexpr auto FRAME = std::chrono::milliseconds(16);
+
+  struct Inbound {
+    enum class To : uint8_t { MENU, GAME, START_GAME, CLOCK } to = To::MENU;
+    NM::Message message;
+  };
+
   std::unique_ptr<GUIMenuDisplay> menu;
   std::unique_ptr<GUIGame>        game;
+  std::shared_ptr<sf::RenderWindow> window;
   ClientTimer* timer;
 
   bool gameExists = false;
 
-  std::jthread gui_thread;
-  std::mutex thread_mutex;
+  SpscQueue<Inbound, 1024>        inbox;   // Network thread to this one
+  SpscQueue<NM::Message, 256>     outbox;  // This thread to the network one
+  std::counting_semaphore<>       inbox_ready{0};
+  int                             outbox_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)};
+  std::deque<NM::Message>         unsent;  // While the outbox is full, never waited on
+
+  std::jthread gui_thread;  // Last, so that it starts once everything above exists
+
+  /**
+   * Network thread side: waits for room rather than dropping anything,
+   * this thread never waiting on the network one.
+   */
+  void deliver(Inbound&& item) {
+    while (!inbox.push(std::move(item)))
+      std::this_thread::yield();
+    inbox_ready.release();
+  }
 
-  std::queue<NM::Message> gui_queue;
+  void send(NM::Message&& message) {
+    if (!message.empty())
+      unsent.push_back(std::move(message));
 
- public:
-  GUIThread(menu_data_t&& menu_data) : gui_thread(std::bind_front(&GUIThread::run, this), menu_data), 
-                                                  timer(menu_data.timer) {}
+    bool sent = false;
+    while (!unsent.empty() && outbox.push(std::move(unsent.front()))) {
+      unsent.pop_front();
+      sent = true;
+    }
+    if (sent) {
+      uint64_t one = 1;
+      (void)!write(outbox_fd, &one, sizeof(one));
+    }
+  }
+
+  void apply(Inbound& item) {
+    switch (item.to) {
+      using enum Inbound::To;
+      case MENU:
+        menu->handleServer(item.message);
+        menu->changed = true;
+        break;
+      case GAME:
+        game->handleServer(item.message);
+        game->changed = true;
+        break;
+      case CLOCK:
+        send(timer->acceptClock(item.message));
+        break;
+      case START_GAME:  // Before the game's own messages, which need it
+        send(timer->probe());  // Clocks drift apart, measured again each match
+        menu->is_active = 0;
+        if (gameExists) {
+          game->is_active = 1;
+        } else {
+          startGame(window, timer);
+          gameExists = 1;
+        }
+        game->changed = true;
+        break;
+      default:
+        throw std::runtime_error("Unknown GUI message destination");
+    }
+  }
 
-  void menuHandleServer(const NM::Message& message) {
-    std::scoped_lock lock(thread_mutex);
-    menu->handleServer(message);
+ public:
+  GUIThread(menu_data_t&& menu_data) : timer(menu_data.timer),
+                                       gui_thread(std::bind_front(&GUIThread::run, this), menu_data) {}
+
+  ~GUIThread() {
+    gui_thread.request_stop();
+    if (gui_thread.joinable())
+      gui_thread.join();
+    close(outbox_fd);
   }
 
-  void gameHandleServer(const NM::Message& message) {
-    std::scoped_lock lock(thread_mutex);
-    game->handleServer(message);
+  /**
+   * Readable when there are messages to send.
+   */
+  [[nodiscard]] inline int fd() const { return outbox_fd; }
+
+  void menuHandleServer(const NM::Message& message) { deliver({Inbound::To::MENU, message}); }
+  void gameHandleServer(const NM::Message& message) { deliver({Inbound::To::GAME, message}); }
+  void clockHandleServer(const NM::Message& message) { deliver({Inbound::To::CLOCK, message}); }
+  void switchActiveState()                          { deliver({Inbound::To::START_GAME, {}}); }
+
+  /**
+   * Network thread side.
+   *
+   * \return Every message queued to send since the last call, oldest first.
+   */
+  [[nodiscard]] std::vector<NM::Message> popMessages() {
+    uint64_t count;
+    (void)!read(outbox_fd, &count, sizeof(count));  // Before popping, so that no wake-up is lost
+
+    std::vector<NM::Message> messages;
+    while (auto message = outbox.pop())
+      messages.push_back(std::move(*message));
+    return messages;
   }
 
   void startGame(std::shared_ptr<sf::RenderWindow> window, ClientTimer* timer) {
@@ -53,56 +158,43 @@ class GUIThread {
       mode = 0;
     }
     game = std::make_unique<GUIGame>(window, board_view, board_control, timer, mode);
-  }
-
-  void switchActiveState() {
-    if (menu->is_active)
-      menu->is_active = 0;
-    if (gameExists)
-      game->is_active = 1;
-  }
-
-  [[nodiscard]] std::optional<NM::Message> popMessage() {
-    std::scoped_lock lock(thread_mutex);
-    if (gui_queue.empty())
-      return std::nullopt;
-
-    auto message = gui_queue.front();
-    gui_queue.pop();
-    return message;
+    game->record(std::string(LAST_REPLAY));
   }
 
   void run(std::stop_token token, menu_data_t&& menu_data) {
-    auto&& [view, control, lobby, session, timer] = menu_data;
+    auto&& [view, control, lobby, session, _] = menu_data;
 
-    std::shared_ptr<sf::RenderWindow> window = std::make_shared<sf::RenderWindow>(sf::VideoMode(1500, 1000), "Battleship");
+    window = std::make_shared<sf::RenderWindow>(sf::VideoMode(1500, 1000), "Battleship");
     window->setPosition({100, 100});
 
     menu = std::make_unique<GUIMenuDisplay>(window, view, control, lobby, session);
 
     while (!token.stop_requested() && window->isOpen()) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(33));  // Limit frames to 30 per second
-      std::scoped_lock lock(thread_mutex);
+      while (auto item = inbox.pop())
+        apply(*item);
+
+      // Widgets follow the mouse while a button is held, without events
+      bool held = window->hasFocus() && sf::Mouse::isButtonPressed(sf::Mouse::Left);
+
       if (menu->is_active) {
-        NM::Message message = menu->pollEvent();
-        if (!message.empty()) {
-          gui_queue.push(message);
-        }
-        menu->display();
+        send(menu->pollEvent());
+        if (std::exchange(menu->changed, false) || held)
+          menu->display();
       }
-      if (!menu->is_active && !gameExists) {
-        startGame(window, timer);
-        gameExists = 1;
-      }
-      else if (!menu->is_active && game->is_active) {
-        if (!game->getCommander() && menu->commanderModeSelected())
+      else if (gameExists && game->is_active) {
+        if (!game->getCommander() && menu->commanderModeSelected()) {
           game->setCommander();
-        NM::Message message = game->pollEvent();
-        if (!message.empty()) {
-          gui_queue.push(message);
+          game->changed = true;
         }
-        game->display();
+        send(game->pollEvent());
+        if (timer->update())  // Its fd is non-blocking, checked once a frame
+          send(NM::Message(Networkable::Request::OUT_OF_TIME));
+        if (std::exchange(game->changed, false) || held)
+          game->display();
       }
+
+      (void)inbox_ready.try_acquire_for(FRAME);
+      while (inbox_ready.try_acquire()) {}  // Everything is applied at once
     }
   }
 
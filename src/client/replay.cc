@@ -0,0 +1,317 @@
+#include "replay.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../common/utils.hh"
+
+using NM::Message;
+using std::byte, std::span, std::vector;
+
+namespace {
+  constexpr std::string_view MAGIC        = "BSRP";
+  constexpr std::string_view INDEX_MAGIC  = "BSRI";
+  constexpr uint16_t         VERSION      = 1;
+  constexpr uint8_t          UNKNOWN      = 0xFF;  // Faction
+  constexpr size_t           FACTIONS_AT  = MAGIC.size() + sizeof(VERSION) + sizeof(uint8_t);
+  constexpr size_t           RECORD_SIZE  = sizeof(uint8_t) + sizeof(uint32_t);  // Before its payload
+  constexpr size_t           FOOTER_SIZE  = sizeof(uint64_t) + INDEX_MAGIC.size();
+
+  enum Kind : uint8_t {
+    MOVE = 1,
+    KEYFRAME,
+    INDEX
+  };
+
+  template<typename T>
+  void put(vector<byte>& out, T value) {
+    out.resize(out.size() + sizeof(T));
+    NM::write_le(value, out.data() + out.size() - sizeof(T));
+  }
+
+  void put(vector<byte>& out, std::string_view text) {
+    auto bytes = std::as_bytes(span{text});
+    out.insert(out.end(), bytes.begin(), bytes.end());
+  }
+
+  template<typename T>
+  T get(span<byte const> bytes, uint64_t& offset) {
+    if (offset > bytes.size() || bytes.size() - offset < sizeof(T))
+      throw std::runtime_error("Replay cut short");
+    offset += sizeof(T);
+    return NM::read_le<T>(bytes.data() + offset - sizeof(T));
+  }
+
+  span<byte const> get(span<byte const> bytes, uint64_t& offset, uint64_t size) {
+    if (offset > bytes.size() || bytes.size() - offset < size)
+      throw std::runtime_error("Replay cut short");
+    offset += size;
+    return bytes.subspan(offset - size, size);
+  }
+
+  // Checked as when decoding a message, the file being no more trusted
+  template<typename T>
+  T get_enum(span<byte const> bytes, uint64_t& offset) {
+    uint8_t value = get<uint8_t>(bytes, offset);
+    if (value < NM::EnumRange<T>::first || value > NM::EnumRange<T>::last)
+      throw std::runtime_error("Out of range enum in replay");
+    return static_cast<T>(value);
+  }
+
+  // FNV-1a, enough to tell two streams of moves apart
+  constexpr uint64_t FNV_BASIS = 0xcbf29ce484222325;
+  constexpr uint64_t FNV_PRIME = 0x100000001b3;
+
+  uint64_t hash(uint64_t digest, span<byte const> bytes) {
+    for (byte b : bytes)
+      digest = (digest ^ std::to_integer<uint64_t>(b)) * FNV_PRIME;
+    return digest;
+  }
+
+  vector<byte> frame(Message::ServerFire&& move) {
+    return Message::serialize(Message(Networkable::Request::GAME, std::move(move)));
+  }
+
+  Message message(span<byte const> frame) {
+    return Message::deserialize(vector<byte>(frame.begin(), frame.end()));
+  }
+}
+
+//                   ╔══════════════╗
+//                   ║ ReplayWriter ║
+//                   ╚══════════════╝
+
+ReplayWriter::ReplayWriter(const std::string& path, const ReplayHeader& header)
+  : file{path, std::ios::binary | std::ios::trunc}, _header{header}, _digest{FNV_BASIS} {
+  vector<byte> bytes;
+  put(bytes, MAGIC);
+  put(bytes, VERSION);
+  put(bytes, NM::to_underlying(header.mode));
+  for (auto&& faction : header.factions)
+    put(bytes, faction ? NM::to_underlying(*faction) : UNKNOWN);
+  for (std::string_view name : {header.left, header.right}) {
+    name = name.substr(0, UINT8_MAX);
+    put(bytes, static_cast<uint8_t>(name.size()));
+    put(bytes, name);
+  }
+
+  file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  file.flush();
+  offset = bytes.size();
+}
+
+void ReplayWriter::write(Message::ServerFire&& move) {
+  auto&& [cells, left_board, turn, energy] = move.data();
+  for (const Cell& cell : cells)
+    if (cell.c.x() < BOARDSIZE && cell.c.y() < BOARDSIZE)
+      known.at(left_board ? 0 : 1).at(cell.c.y() * BOARDSIZE + cell.c.x()) = cell;
+
+  vector<byte> bytes = frame(std::move(move));
+  _digest = hash(_digest, bytes);
+  moves.push_back(offset);
+  record(MOVE, bytes);
+
+  if (moves.size() % KEYFRAME_EVERY == 0)
+    keyframe();
+  file.flush();  // Whatever was played survives the client
+}
+
+void ReplayWriter::keyframe() {
+  vector<byte> bytes;
+  put(bytes, static_cast<uint32_t>(moves.size()));
+
+  for (size_t board = 0; board < known.size(); ++board) {
+    vector<Cell> cells;
+    for (auto&& cell : known.at(board))
+      if (cell)
+        cells.push_back(*cell);
+
+    vector<byte> board_frame = frame(Message::ServerFire(cells, board == 0, false, 0));
+    if (board == 0)
+      put(bytes, static_cast<uint32_t>(board_frame.size()));
+    bytes.insert(bytes.end(), board_frame.begin(), board_frame.end());
+  }
+
+  keyframes.emplace_back(static_cast<uint32_t>(moves.size()), offset);
+  record(KEYFRAME, bytes);
+}
+
+void ReplayWriter::record(uint8_t kind, span<byte const> payload) {
+  vector<byte> head;
+  put(head, kind);
+  put(head, static_cast<uint32_t>(payload.size()));
+
+  file.write(reinterpret_cast<const char*>(head.data()), static_cast<std::streamsize>(head.size()));
+  file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+  offset += head.size() + payload.size();
+}
+
+void ReplayWriter::setFaction(size_t seat, GameModel::Faction faction) {
+  seat = std::min<size_t>(seat, 1);
+  _header.factions.at(seat) = faction;
+  file.seekp(static_cast<std::streamoff>(FACTIONS_AT + seat));
+  file.put(static_cast<char>(NM::to_underlying(faction)));
+  file.seekp(static_cast<std::streamoff>(offset));
+  file.flush();
+}
+
+void ReplayWriter::finish() {
+  vector<byte> bytes;
+  put(bytes, static_cast<uint32_t>(moves.size()));
+  put(bytes, static_cast<uint32_t>(keyframes.size()));
+  for (uint64_t move : moves)
+    put(bytes, move);
+  for (auto&& [turn, at] : keyframes) {
+    put(bytes, turn);
+    put(bytes, at);
+  }
+
+  uint64_t index = offset;
+  record(INDEX, bytes);
+
+  vector<byte> footer;
+  put(footer, index);
+  put(footer, INDEX_MAGIC);
+  file.write(reinterpret_cast<const char*>(footer.data()), static_cast<std::streamsize>(footer.size()));
+  file.close();
+}
+
+uint64_t ReplayWriter::digest(const Message::Recording& recording) {
+  uint64_t digest = FNV_BASIS;
+  for (auto&& move : std::get<2>(recording.data())) {
+    auto&& [cells, left_board, turn, energy] = move.data();
+    digest = hash(digest, frame(Message::ServerFire(cells, left_board, false, 0)));
+  }
+  return digest;
+}
+
+//                   ╔══════════════╗
+//                   ║ ReplayReader ║
+//                   ╚══════════════╝
+
+ReplayReader::ReplayReader(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1)
+    throw std::runtime_error("Could not open " + path);
+
+  struct stat status;
+  if (fstat(fd, &status) == -1 || status.st_size == 0) {
+    close(fd);
+    throw std::runtime_error("Could not read " + path);
+  }
+
+  size_t size = static_cast<size_t>(status.st_size);
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  // The mapping keeps the file
+  if (mapped == MAP_FAILED)
+    throw std::runtime_error("Could not map " + path);
+  bytes = {static_cast<const byte*>(mapped), size};
+
+  try {
+    uint64_t offset = 0;
+    span<byte const> magic = get(bytes, offset, MAGIC.size());
+    if (std::memcmp(magic.data(), MAGIC.data(), MAGIC.size()) != 0 || get<uint16_t>(bytes, offset) != VERSION)
+      throw std::runtime_error(path + " is not a replay");
+
+    _header.mode = get_enum<GameModel::GameMode>(bytes, offset);
+    for (auto&& faction : _header.factions)
+      if (offset < bytes.size() && bytes[offset] == byte{UNKNOWN})
+        ++offset;
+      else
+        faction = get_enum<GameModel::Faction>(bytes, offset);
+    for (std::string* name : {&_header.left, &_header.right}) {
+      span<byte const> text = get(bytes, offset, get<uint8_t>(bytes, offset));
+      name->assign(reinterpret_cast<const char*>(text.data()), text.size());
+    }
+
+    if (!readIndex())
+      walk(offset);
+  } catch (...) {
+    munmap(const_cast<byte*>(bytes.data()), bytes.size());
+    throw;
+  }
+}
+
+ReplayReader::~ReplayReader() {
+  munmap(const_cast<byte*>(bytes.data()), bytes.size());
+}
+
+bool ReplayReader::readIndex() {
+  if (bytes.size() < FOOTER_SIZE
+      || std::memcmp(bytes.data() + bytes.size() - INDEX_MAGIC.size(), INDEX_MAGIC.data(), INDEX_MAGIC.size()) != 0)
+    return false;
+
+  uint64_t offset = bytes.size() - FOOTER_SIZE;
+  uint64_t at     = get<uint64_t>(bytes, offset);
+  span<byte const> index = payload(at);
+
+  offset = 0;
+  uint32_t move_count     = get<uint32_t>(index, offset);
+  uint32_t keyframe_count = get<uint32_t>(index, offset);
+  for (uint32_t i = 0; i < move_count; ++i)
+    moves.push_back(get<uint64_t>(index, offset));
+  for (uint32_t i = 0; i < keyframe_count; ++i) {
+    uint32_t turn = get<uint32_t>(index, offset);
+    keyframes.emplace_back(turn, get<uint64_t>(index, offset));
+  }
+  return true;
+}
+
+void ReplayReader::walk(uint64_t offset) {
+  // Whatever was flushed before the match was cut short
+  while (bytes.size() - offset >= RECORD_SIZE) {
+    uint64_t at = offset;
+    uint8_t kind  = get<uint8_t>(bytes, offset);
+    uint32_t size = get<uint32_t>(bytes, offset);
+    if (bytes.size() - offset < size)
+      break;
+
+    if (kind == MOVE)
+      moves.push_back(at);
+    else if (kind == KEYFRAME && size >= sizeof(uint32_t)) {
+      uint64_t turn_at = offset;
+      keyframes.emplace_back(get<uint32_t>(bytes, turn_at), at);
+    } else if (kind == INDEX)
+      break;
+    offset += size;
+  }
+}
+
+span<byte const> ReplayReader::payload(uint64_t offset) const {
+  (void)get<uint8_t>(bytes, offset);
+  uint32_t size = get<uint32_t>(bytes, offset);
+  return get(bytes, offset, size);
+}
+
+Message ReplayReader::move(size_t turn) const {
+  return message(payload(moves.at(turn)));
+}
+
+vector<Message> ReplayReader::seek(size_t turn) const {
+  turn = std::min(turn, turns());
+  vector<Message> messages;
+
+  // Last keyframe at or before the turn
+  auto after = std::ranges::upper_bound(keyframes, turn, {}, [](auto&& keyframe) { return keyframe.first; });
+  size_t from = 0;
+  if (after != keyframes.begin()) {
+    auto&& [keyframe_turn, at] = *std::prev(after);
+    span<byte const> boards = payload(at);
+
+    uint64_t offset = sizeof(uint32_t);
+    uint32_t left_size = get<uint32_t>(boards, offset);
+    messages.push_back(message(get(boards, offset, left_size)));
+    messages.push_back(message(boards.subspan(offset)));
+    from = keyframe_turn;
+  }
+
+  for (size_t i = from; i < turn; ++i)
+    messages.push_back(move(i));
+  return messages;
+}
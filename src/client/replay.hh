@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../common/board_common.hh"
+#include "../common/serializer.hh"
+
+inline constexpr std::string_view LAST_REPLAY = "./last.replay";  // Of the last match played or watched
+
+/**
+ * Replay file, version 1. Integers are little-endian.
+ *
+ *   header    "BSRP", u16 version, u8 mode, u8 left faction, u8 right
+ *             faction (0xFF if unknown), then each name as a u8 length
+ *             and its bytes
+ *   records   u8 kind, u32 size, then size bytes:
+ *               MOVE      a GAME frame with the ServerFire, as from the left
+ *               KEYFRAME  the u32 turn it follows, the u32 size of the
+ *                         left board's frame, then two such frames with
+ *                         every known cell, of each board
+ *               INDEX     u32 moves, u32 keyframes, the u64 offset of every
+ *                         move record, then a u32 turn and u64 offset for
+ *                         every keyframe record
+ *   footer    u64 offset of the INDEX record, "BSRI"
+ *
+ * Moves are appended as they are played, the index once the match is
+ * over; a file cut short is read by walking its records instead.
+ */
+struct ReplayHeader {
+  std::string left;
+  std::string right;
+  GameModel::GameMode mode = GameModel::GameMode::CLASSIC;
+  std::array<std::optional<GameModel::Faction>, 2> factions;  // Left then right, as far as whoever recorded knew
+};
+
+class ReplayWriter {
+ public:
+  using Cell = NM::Message::ServerFire::Cell;
+
+  static constexpr size_t KEYFRAME_EVERY = 16;  // Moves, at most, to replay after a seek
+
+  /**
+   * Truncates the file and writes the header.
+   */
+  ReplayWriter(const std::string& path, const ReplayHeader& header);
+
+  /**
+   * Appends a move and flushes it, with a keyframe every KEYFRAME_EVERY.
+   * Only what the boards show is kept, turn and energy are dropped.
+   *
+   * \param Whether the cells are on the left player's board.
+   * \param Cells the move revealed.
+   */
+  template<NM::RangeOf<Cell> R>
+  void append(bool left_board, R&& cells) {
+    write(NM::Message::ServerFire(std::forward<R>(cells), left_board, false, 0));
+  }
+
+  /**
+   * Rewrites a faction in the header, once it is known.
+   *
+   * \param 0 for the left player, 1 for the right one.
+   */
+  void setFaction(size_t seat, GameModel::Faction faction);
+
+  /**
+   * Writes the index and footer, after which nothing may be appended.
+   */
+  void finish();
+
+  [[nodiscard]] inline const ReplayHeader& header() const { return _header; }
+  [[nodiscard]] inline bool                good()   const { return file.good(); }
+  [[nodiscard]] inline size_t              turns()  const { return moves.size(); }
+  [[nodiscard]] inline uint64_t            digest() const { return _digest; }
+
+  /**
+   * \return What digest() would be once every move of the recording is
+   *         appended, to tell whether a streamed file missed any.
+   */
+  [[nodiscard]] static uint64_t digest(const NM::Message::Recording& recording);
+
+  ReplayWriter(ReplayWriter&&)      = delete;
+  ReplayWriter(const ReplayWriter&) = delete;
+
+ private:
+  std::ofstream file;
+  ReplayHeader _header;
+  uint64_t offset = 0;
+  uint64_t _digest;
+
+  std::vector<uint64_t> moves;                            // Offsets of move records
+  std::vector<std::pair<uint32_t, uint64_t>> keyframes;   // Turn and offset of keyframe records
+  std::array<std::array<std::optional<Cell>, BOARDSIZE * BOARDSIZE>, 2> known;  // Left then right board
+
+  void write(NM::Message::ServerFire&& move);
+  void keyframe();
+  void record(uint8_t kind, std::span<std::byte const> payload);
+};
+
+/**
+ * Maps a replay file to memory. Any turn is reached from the keyframe
+ * before it, never from the first move.
+ */
+class ReplayReader {
+ public:
+  /**
+   * Throws std::runtime_error if the file cannot be read or is not a
+   * replay.
+   */
+  explicit ReplayReader(const std::string& path);
+  ~ReplayReader();
+
+  [[nodiscard]] inline const ReplayHeader& header() const { return _header; }
+  [[nodiscard]] inline size_t              turns()  const { return moves.size(); }
+
+  /**
+   * \return Messages bringing a new spectator's view to the boards after
+   *         that many moves: the keyframe before it, then the moves since.
+   */
+  [[nodiscard]] std::vector<NM::Message> seek(size_t turn) const;
+
+  /**
+   * \return Move of that index, counting from 0.
+   */
+  [[nodiscard]] NM::Message move(size_t turn) const;
+
+  ReplayReader(ReplayReader&&)      = delete;
+  ReplayReader(const ReplayReader&) = delete;
+
+ private:
+  std::span<std::byte const> bytes;
+  ReplayHeader _header;
+  std::vector<uint64_t> moves;
+  std::vector<std::pair<uint32_t, uint64_t>> keyframes;
+
+  bool readIndex();
+  void walk(uint64_t offset);
+  [[nodiscard]] std::span<std::byte const> payload(uint64_t offset) const;
+};
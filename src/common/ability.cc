@@ -1,6 +1,37 @@
 #include "ability.hh"
 
+#include <array>
+
 using enum Ability::Type;
+using std::array;
+
+namespace {
+  constexpr size_t TYPES   = static_cast<size_t>(A_SENTINEL);
+  constexpr size_t ORIGINS = BOARDSIZE * BOARDSIZE;
+
+  constexpr array<Shape, TYPES> SHAPES{
+    Shape{{0, 0}},                                      // Basic
+    Shape{{0, 0}, {1, 1}, {-1, -1}},                    // Diagonal
+    Shape{{0, 0}, {1, -1}, {1, 1}, {-1, -1}, {-1, 1}},  // XBomb
+    Shape{{0, 0}, {1, 0}, {-1, 0}},                     // Linear
+    Shape{{0, 0}, {1, 0}, {-1, 0}, {0, 1}, {0, -1}},    // PlusBomb
+  };
+
+  // Every origin of every ability, 8 kB
+  constexpr auto FOOTPRINTS = [] {
+    array<array<Bitboard, ORIGINS>, TYPES> footprints{};
+    for (size_t type = 0; type < TYPES; ++type)
+      for (size_t origin = 0; origin < ORIGINS; ++origin)
+        footprints[type][origin] = SHAPES[type].clipped({origin % BOARDSIZE, origin / BOARDSIZE});
+    return footprints;
+  }();
+
+  size_t index(Ability::Type type) {
+    if (type >= A_SENTINEL)
+      throw NotImplementedError("Ability type not implemented");
+    return static_cast<size_t>(type);
+  }
+}
 
 void Ability::setType(Type abilityType){
     type = abilityType;
@@ -13,3 +44,17 @@ void Ability::setType(Type abilityType){
             break;
     }
 }
+
+const Shape& Ability::shape(Type type) {
+  return SHAPES[index(type)];
+}
+
+Bitboard Ability::footprint(Type type, BoardCoordinates origin) {
+  if (!Bitboard::inBounds(origin))
+    return {};
+  return FOOTPRINTS[index(type)][origin.y() * BOARDSIZE + origin.x()];
+}
+
+Footprint Ability::assembleByType(Type type, BoardCoordinates origin) {
+  return shape(type).at(origin);
+}
@@ -7,6 +7,7 @@
 #include <algorithm>
 
 #include "../common/board_coordinates.hh"
+#include "shape.hh"
 #include "not_implemented_error.hh"
 
 namespace ranges = std::ranges;
@@ -39,36 +40,14 @@ class Ability{
     [[nodiscard]] inline int getCost() const { return cost; }
     void setCost(int value) {cost = value;}
 
-  static vector<BoardCoordinates> assembleByType(Type type, BoardCoordinates origin) {
-    vector<BoardCoordinates> coordinates{origin};
-    switch (type) {
-      using enum Type;
-      case Basic:
-        break;
-      case Linear:
-        coordinates.emplace_back(BoardCoordinates{origin.x() + 1, origin.y()});
-        coordinates.emplace_back(BoardCoordinates{origin.x() - 1, origin.y()});
-        break;
-      case Diagonal:
-        coordinates.emplace_back(BoardCoordinates{origin.x() + 1, origin.y() + 1});
-        coordinates.emplace_back(BoardCoordinates{origin.x() - 1, origin.y() - 1});
-        break;
-      case XBomb:
-        coordinates.emplace_back(BoardCoordinates{origin.x() + 1, origin.y()-1});
-        coordinates.emplace_back(BoardCoordinates{origin.x() + 1, origin.y()+1});
-        coordinates.emplace_back(BoardCoordinates{origin.x() - 1, origin.y()-1});
-        coordinates.emplace_back(BoardCoordinates{origin.x() - 1, origin.y()+1});
-        break;
-      case PlusBomb:
-        coordinates.emplace_back(BoardCoordinates{origin.x() + 1, origin.y()});
-        coordinates.emplace_back(BoardCoordinates{origin.x() - 1, origin.y()});
-        coordinates.emplace_back(BoardCoordinates{origin.x(), origin.y() + 1});
-        coordinates.emplace_back(BoardCoordinates{origin.x(), origin.y() - 1});
-        break;
-      default:
-        throw NotImplementedError("Ability type not implemented");
-    }
+  static const Shape& shape(Type type);
 
-    return coordinates;
-  }
+  /**
+   * Looked up in a table of every origin, built at compile time.
+   *
+   * \return Cells hit from origin, those off the board left out.
+   */
+  static Bitboard footprint(Type type, BoardCoordinates origin);
+
+  static Footprint assembleByType(Type type, BoardCoordinates origin);
 };
\ No newline at end of file
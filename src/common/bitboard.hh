@@ -0,0 +1,139 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <span>
+
+#include "board_common.hh"
+#include "board_coordinates.hh"
+
+/**
+ * Set of cells of a board, one bit each, y * BOARDSIZE + x: a whole
+ * board fits in two registers and set operations on cells are single
+ * instructions. Cells outside of the board are never members.
+ */
+class Bitboard {
+  __extension__ using bits_t = unsigned __int128;
+
+  static constexpr size_t CELLS = BOARDSIZE * BOARDSIZE;
+  static_assert(CELLS <= 128, "Board does not fit in a bitboard");
+
+  bits_t bits = 0;
+
+  constexpr explicit Bitboard(bits_t bits) : bits{bits} {}
+
+  static constexpr bits_t ALL        = (bits_t{1} << CELLS) - 1;
+  static constexpr bits_t LEFT_EDGE  = ALL / ((bits_t{1} << BOARDSIZE) - 1);  // First bit of every row
+  static constexpr bits_t RIGHT_EDGE = LEFT_EDGE << (BOARDSIZE - 1);
+
+ public:
+  class iterator {
+    bits_t rest = 0;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = BoardCoordinates;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = void;
+    using reference         = BoardCoordinates;
+
+    constexpr iterator() = default;
+    constexpr explicit iterator(bits_t rest) : rest{rest} {}
+
+    constexpr BoardCoordinates operator*() const {
+      auto low   = static_cast<uint64_t>(rest);
+      size_t bit = low ? static_cast<size_t>(std::countr_zero(low)) : 64 + static_cast<size_t>(std::countr_zero(static_cast<uint64_t>(rest >> 64)));
+      return {bit % BOARDSIZE, bit / BOARDSIZE};
+    }
+    constexpr iterator& operator++() { rest &= rest - 1; return *this; }
+    constexpr iterator operator++(int) { iterator copy = *this; ++*this; return copy; }
+    constexpr bool operator==(const iterator&) const = default;
+  };
+
+  constexpr Bitboard() = default;
+
+  /**
+   * \return Set of that single cell, empty if outside of the board.
+   */
+  static constexpr Bitboard cell(BoardCoordinates c) {
+    return Bitboard{inBounds(c) ? bits_t{1} << (c.y() * BOARDSIZE + c.x()) : 0};
+  }
+
+  /**
+   * \return Set of these cells, leaving out those outside of the board.
+   */
+  static constexpr Bitboard of(std::span<BoardCoordinates const> cells) {
+    Bitboard mask;
+    for (BoardCoordinates c : cells)
+      mask |= cell(c);
+    return mask;
+  }
+
+  static constexpr Bitboard full() { return Bitboard{ALL}; }
+
+  [[nodiscard]] static constexpr inline bool inBounds(BoardCoordinates c) { return c.x() < BOARDSIZE && c.y() < BOARDSIZE; }
+
+  [[nodiscard]] constexpr inline bool   test(BoardCoordinates c) const { return (bits & cell(c).bits) != 0; }
+  [[nodiscard]] constexpr inline bool   empty() const { return bits == 0; }
+  [[nodiscard]] constexpr inline size_t count() const {
+    return static_cast<size_t>(std::popcount(static_cast<uint64_t>(bits)) + std::popcount(static_cast<uint64_t>(bits >> 64)));
+  }
+
+  constexpr inline void set(BoardCoordinates c, bool value = true) {
+    if (value)
+      bits |= cell(c).bits;
+    else
+      bits &= ~cell(c).bits;
+  }
+
+  /**
+   * \return Cells sharing a side with one of the set, the set excluded.
+   */
+  [[nodiscard]] constexpr Bitboard neighbours() const {
+    bits_t spread = ((bits << 1) & ~LEFT_EDGE) | ((bits >> 1) & ~RIGHT_EDGE) | (bits << BOARDSIZE) | (bits >> BOARDSIZE);
+    return Bitboard{spread & ALL & ~bits};
+  }
+
+  constexpr Bitboard  operator~() const { return Bitboard{~bits & ALL}; }
+  constexpr Bitboard  operator&(Bitboard other) const { return Bitboard{bits & other.bits}; }
+  constexpr Bitboard  operator|(Bitboard other) const { return Bitboard{bits | other.bits}; }
+  constexpr Bitboard  operator^(Bitboard other) const { return Bitboard{bits ^ other.bits}; }
+  constexpr Bitboard& operator&=(Bitboard other) { bits &= other.bits; return *this; }
+  constexpr Bitboard& operator|=(Bitboard other) { bits |= other.bits; return *this; }
+  constexpr Bitboard& operator^=(Bitboard other) { bits ^= other.bits; return *this; }
+  constexpr bool      operator==(const Bitboard&) const = default;
+
+  /**
+   * Cells of the set, row by row.
+   */
+  [[nodiscard]] constexpr iterator begin() const { return iterator{bits}; }
+  [[nodiscard]] constexpr iterator end()   const { return iterator{}; }
+};
+
+/**
+ * Everything known of one side's board, as one bitboard per flag of
+ * GameModel::CellType: a board is 48 bytes, and the state of a cell is
+ * the flags of the masks it belongs to.
+ */
+struct BoardMasks {
+  Bitboard ships;
+  Bitboard known;
+  Bitboard sunk;
+
+  [[nodiscard]] constexpr GameModel::CellType at(BoardCoordinates c) const {
+    return static_cast<GameModel::CellType>((ships.test(c) ? GameModel::IS_SHIP : 0) | (known.test(c) ? GameModel::IS_KNOWN : 0)
+                                            | (sunk.test(c) ? GameModel::IS_SUNK : 0));
+  }
+
+  constexpr void set(BoardCoordinates c, GameModel::CellType type) {
+    ships.set(c, type & GameModel::IS_SHIP);
+    known.set(c, type & GameModel::IS_KNOWN);
+    sunk.set(c, type & GameModel::IS_SUNK);
+  }
+
+  /**
+   * \return Ship cells not hit yet.
+   */
+  [[nodiscard]] constexpr Bitboard afloat() const { return ships & ~known; }
+};
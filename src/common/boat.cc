@@ -1,11 +1,50 @@
 #include "boat.hh"
 
 #include <algorithm>
-#include <ranges>
-#include <functional>
+#include <array>
 
 namespace ranges = std::ranges;
-namespace views = std::ranges::views;
+using std::array;
+
+namespace {
+  constexpr size_t TYPES   = static_cast<size_t>(Boat::Type::SENTINEL);
+  constexpr size_t ORIGINS = BOARDSIZE * BOARDSIZE;
+
+  // In the order the cells have always been sent in
+  constexpr array<Shape, TYPES> UPRIGHT{
+    Shape{{0, 0}, {1, 0}},                          // Destroyer
+    Shape{{0, 0}, {2, 0}, {1, 0}},                  // Cruiser
+    Shape{{0, 0}, {3, 0}, {2, 0}, {1, 0}},          // Battleship
+    Shape{{0, 0}, {4, 0}, {3, 0}, {2, 0}, {1, 0}},  // Carrier
+    Shape{{0, 0}, {1, 0}, {1, 1}, {2, 1}},          // Z_Tetromino
+    Shape{{0, 0}, {0, 1}, {1, 1}, {2, 1}},          // J_Tetromino
+    Shape{{0, 0}, {0, 1}, {0, 2}, {1, 1}},          // T_Tetromino
+  };
+
+  constexpr auto SHAPES = [] {
+    array<array<Shape, Boat::ROTATIONS>, TYPES> shapes{};
+    for (size_t type = 0; type < TYPES; ++type)
+      for (size_t rotation = 0; rotation < Boat::ROTATIONS; ++rotation)
+        shapes[type][rotation] = UPRIGHT[type].rotated(rotation);
+    return shapes;
+  }();
+
+  // Every placement of every ship, 45 kB
+  constexpr auto FOOTPRINTS = [] {
+    array<array<array<Bitboard, ORIGINS>, Boat::ROTATIONS>, TYPES> footprints{};
+    for (size_t type = 0; type < TYPES; ++type)
+      for (size_t rotation = 0; rotation < Boat::ROTATIONS; ++rotation)
+        for (size_t origin = 0; origin < ORIGINS; ++origin)
+          footprints[type][rotation][origin] = SHAPES[type][rotation].mask({origin % BOARDSIZE, origin / BOARDSIZE});
+    return footprints;
+  }();
+
+  size_t index(Boat::Type type) {
+    if (type >= Boat::Type::SENTINEL)
+      throw NotImplementedError("Boat type not implemented");
+    return static_cast<size_t>(type);
+  }
+}
 
 vector<Boat::Type> Boat::createInventory(GameModel::Faction faction) {
   switch (faction) {
@@ -23,68 +62,26 @@ vector<Boat::Type> Boat::createInventory(GameModel::Faction faction) {
   }
 }
 
-vector<BoardCoordinates> Boat::assembleByType(Type type, BoardCoordinates origin) {
-    vector<BoardCoordinates> coordinates{ origin };
-    switch (type) {
-        using enum Type;
-        case Carrier:
-            coordinates.emplace_back(BoardCoordinates{ origin.x() + 4, origin.y() });
-            [[fallthrough]];
-        case Battleship:
-            coordinates.emplace_back(BoardCoordinates{ origin.x() + 3, origin.y() });
-            [[fallthrough]];
-        case Cruiser:
-            coordinates.emplace_back(BoardCoordinates{ origin.x() + 2, origin.y() });
-            [[fallthrough]];
-        case Destroyer:
-            coordinates.emplace_back(BoardCoordinates{ origin.x() + 1, origin.y() });
-            break;
-        case Z_Tetromino:
-            coordinates.emplace_back(BoardCoordinates{ origin.x() + 1, origin.y() });
-            coordinates.emplace_back(BoardCoordinates{ origin.x() + 1, origin.y() + 1 });
-            coordinates.emplace_back(BoardCoordinates{ origin.x() + 2, origin.y() + 1 });
-            break;
-        case J_Tetromino:
-            coordinates.emplace_back(BoardCoordinates{ origin.x(),     origin.y() + 1 });
-            coordinates.emplace_back(BoardCoordinates{ origin.x() + 1, origin.y() + 1 });
-            coordinates.emplace_back(BoardCoordinates{ origin.x() + 2, origin.y() + 1 });
-            break;
-        case T_Tetromino:
-            coordinates.emplace_back(BoardCoordinates{ origin.x(),     origin.y() + 1 });
-            coordinates.emplace_back(BoardCoordinates{ origin.x(),     origin.y() + 2 });
-            coordinates.emplace_back(BoardCoordinates{ origin.x() + 1, origin.y() + 1 });
-            break;
-        default:
-            throw NotImplementedError("Boat type not implemented");
-    }
+const Shape& Boat::shape(Type type, size_t rotation) {
+  return SHAPES[index(type)][rotation % ROTATIONS];
+}
 
-    return coordinates;
+Bitboard Boat::footprint(Type type, size_t rotation, BoardCoordinates origin) {
+  if (!Bitboard::inBounds(origin))
+    return {};
+  return FOOTPRINTS[index(type)][rotation % ROTATIONS][origin.y() * BOARDSIZE + origin.x()];
 }
 
-bool Boat::isCorrect(Type type, std::span<BoardCoordinates const> coordinates) {
-  vector<BoardCoordinates> coordinates_template = assembleByType(type, coordinates[0]);
+Footprint Boat::assembleByType(Type type, BoardCoordinates origin) {
+  return shape(type).at(origin);
+}
 
-  if (coordinates.size() != coordinates_template.size())
+bool Boat::isCorrect(Type type, std::span<BoardCoordinates const> coordinates) {
+  if (coordinates.size() != shape(type).size())
     return false;
 
-  auto&& fulcrum = coordinates[0];
-
-  std::array<std::function<BoardCoordinates(const BoardCoordinates&)>, 3> rotations{
-    // 90, 180, -90
-    [&fulcrum](const BoardCoordinates& ship_cell) { 
-      return BoardCoordinates{fulcrum.x() - fulcrum.y() + ship_cell.y(), fulcrum.y() - ship_cell.x() + fulcrum.x()};
-    },
-    [&fulcrum](const BoardCoordinates& ship_cell) { 
-      return BoardCoordinates{ship_cell.x() - 2 * (ship_cell.x() - fulcrum.x()), ship_cell.y() - 2 * (ship_cell.y() - fulcrum.y())};
-    },
-    [&fulcrum](const BoardCoordinates& ship_cell) { 
-      return BoardCoordinates{fulcrum.x() - ship_cell.y() + fulcrum.y(), fulcrum.y() - fulcrum.x() + ship_cell.x()};
-    }
-  };
-
-  auto matches = [&coordinates, &coordinates_template](std::function<BoardCoordinates(const BoardCoordinates&)> transform) {
-    return ranges::equal(coordinates, coordinates_template | views::transform(transform));
-  };
-
-  return ranges::equal(coordinates, coordinates_template) || ranges::any_of(rotations, matches);
+  for (size_t rotation = 0; rotation < ROTATIONS; ++rotation)
+    if (ranges::equal(coordinates, shape(type, rotation).at(coordinates[0])))
+      return true;
+  return false;
 }
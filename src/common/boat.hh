@@ -7,6 +7,7 @@
 #include "not_implemented_error.hh"
 #include "board_coordinates.hh"
 #include "board_common.hh"
+#include "shape.hh"
 
 class Boat {
  public:
@@ -21,8 +22,29 @@ class Boat {
     SENTINEL
   };
 
+  static constexpr size_t ROTATIONS = 4;  // Quarter turns around the first cell
+
   static vector<Type> createInventory(GameModel::Faction faction);
-  static vector<BoardCoordinates> assembleByType(Type type, BoardCoordinates origin);
+
+  /**
+   * \return Cells of the type relative to its first one, as turned.
+   */
+  static const Shape& shape(Type type, size_t rotation = 0);
+
+  /**
+   * Looked up in a table of every placement, built at compile time.
+   *
+   * \return Cells of the type from origin, as turned, empty if some of
+   *         them would be off the board.
+   */
+  static Bitboard footprint(Type type, size_t rotation, BoardCoordinates origin);
+
+  static Footprint assembleByType(Type type, BoardCoordinates origin);
+
+  /**
+   * \return Whether the cells are those of the type, in its order, turned
+   *         around the first of them.
+   */
   static bool isCorrect(Type type, std::span<BoardCoordinates const> coordinates);
 
   Boat(Boat::Type type, int id) : type{type}, id{id} {}
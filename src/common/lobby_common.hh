@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+#include <string>
+#include <tuple>
+
 #include "board_common.hh"
 #include "timer.hh"
 
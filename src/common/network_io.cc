@@ -2,6 +2,9 @@
 
 #include <iostream>
 #include <ranges>
+#include <cstring>
+#include <cerrno>
+#include <sys/uio.h>
 
 #include "serializer.hh"
 
@@ -9,25 +12,232 @@
 //                   ║ I/O Functions ║
 //                   ╚═══════════════╝
 
-void Networkable::write_message(int recipient, NM::Message&& message)  {
-  vector<std::byte> data = NM::Message::serialize(std::move(message));
+bool Networkable::write_message(int recipient, NM::Message&& message)  {
+  Peer& peer = peers[recipient];
+  auto data  = std::make_shared<vector<std::byte> const>(NM::Message::serialize(std::move(message)));
 
-  if (data.size() > MAXSHORT) return;
+  if (data->size() > MAX_MESSAGE) {
+    std::cerr << "Dropping a message of " << data->size() << " bytes, too large to send\n";
+    return true;
+  }
 
-  uint16_t size = htons(data.size());
-  send(recipient, &size, sizeof(uint16_t), MSG_DONTWAIT);
-  send(recipient, data.data(), data.size(), MSG_DONTWAIT);
+  queue(peer, std::move(data));
+  return flush(recipient);
 }
 
-NM::Message Networkable::read_message(int sender) {
-  vector<std::byte> data;
+std::vector<int> Networkable::broadcast(std::span<int const> recipients, std::span<NM::Message const> messages) {
+  // Encoded on first use, once for every recipient
+  vector<Buffer> encoded(messages.size());
+  vector<int> broken;
 
-  uint16_t size;
-  recv(sender, &size, sizeof(uint16_t), MSG_WAITALL);
-  size = ntohs(size);
+  for (int recipient : recipients) {
+    Peer& peer = peers[recipient];
+    for (size_t i = 0; i < messages.size(); ++i) {
+      Buffer& data = encoded[i];
+      if (!data) {
+        data = std::make_shared<vector<std::byte> const>(NM::Message::serialize(NM::Message(messages[i])));
+        if (data->size() > MAX_MESSAGE)
+          std::cerr << "Dropping a message of " << data->size() << " bytes, too large to send\n";
+      }
+      if (data->size() <= MAX_MESSAGE)
+        queue(peer, data);
+    }
+    if (!flush(recipient))
+      broken.push_back(recipient);
+  }
+  return broken;
+}
+
+void Networkable::queue(Peer& peer, Buffer data) {
+  peer.queued += data->size();
+
+  if (data->size() <= CHUNK_SIZE) {
+    Frame frame = makeFrame(Kind::WHOLE, *data);
+    frame.body = std::move(data);  // Keeps the buffer the payload points to
+    peer.queued += frame.header_size;
+    peer.outbound.push_back(std::move(frame));
+  } else {
+    peer.streams.push_back({.data = std::move(data)});
+  }
+}
+
+Networkable::Frame Networkable::makeFrame(Kind kind, std::span<std::byte const> payload) {
+  Frame frame{.kind = kind, .payload = payload};
+  frame.header_size = NM::write_varint(payload.size() << 2 | static_cast<uint8_t>(kind), frame.header.data());
+  return frame;
+}
+
+void Networkable::queueChunk(Peer& peer) {
+  Stream& stream = peer.streams.front();
+  size_t size = std::min(CHUNK_SIZE, stream.data->size() - stream.framed);
+  Kind kind   = stream.framed + size == stream.data->size() ? Kind::LAST : Kind::CHUNK;
+
+  Frame frame = makeFrame(kind, std::span<std::byte const>{*stream.data}.subspan(stream.framed, size));
+  stream.framed += size;
+  peer.queued   += frame.header_size;
+  peer.outbound.push_back(std::move(frame));
+  peer.streaming = true;
+}
+
+bool Networkable::greet(int peer) {
+  peers[peer].greeted = true;
+  return write_message(peer, NM::Message(Request::HELLO, NM::Message::Hello(Encoding::LATEST)));
+}
+
+NM::Message Networkable::answerClock(const NM::Message& probe) {
+  auto sync = probe.extract<NM::Message::ClockSync>();
+  if (!sync)
+    return {};
+  return NM::Message(Request::CLOCK, NM::Message::ClockSync(std::get<0>(sync->data()), Timer::toWire(Timer::Clock::now())));
+}
+
+void Networkable::acceptHello(int sender, const NM::Message& message) {
+  auto hello = message.extract<NM::Message::Hello>();
+  if (!hello)
+    return;
+
+  Encoding agreed = std::min(hello->data(), Encoding::LATEST);
+  if (!peers[sender].greeted) {
+    peers[sender].greeted = true;
+    write_message(sender, NM::Message(Request::HELLO, NM::Message::Hello(agreed)));
+  }
+  peers[sender].encoding = agreed;
+}
+
+bool Networkable::flush(int recipient) {
+  auto it = peers.find(recipient);
+  if (it == peers.end())
+    return true;
+  Peer& peer = it->second;
 
-  data.resize(size);
-  recv(sender, data.data(), size, MSG_WAITALL);
+  while (true) {
+    // Only one chunk is queued at a time, messages written meanwhile go in between
+    if (!peer.streaming && !peer.streams.empty())
+      queueChunk(peer);
+    if (peer.outbound.empty())
+      break;
+
+    std::array<iovec, WRITE_FRAMES * 2> iov;
+    size_t count = 0;
+    size_t skip  = peer.sent;
+
+    for (auto&& frame : peer.outbound | std::views::take(WRITE_FRAMES)) {
+      for (std::span<std::byte const> part : {std::span<std::byte const>{frame.header.data(), frame.header_size}, frame.payload}) {
+        if (skip >= part.size()) {
+          skip -= part.size();
+          continue;
+        }
+        iov[count++] = {const_cast<std::byte*>(part.data()) + skip, part.size() - skip};
+        skip = 0;
+      }
+    }
+
+    msghdr header{.msg_iov = iov.data(), .msg_iovlen = count};
+    ssize_t written = sendmsg(recipient, &header, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (written == -1) {
+      if (errno == EINTR)
+        continue;
+      return errno == EAGAIN;
+    }
+
+    peer.queued -= written;
+    peer.sent   += written;
+    while (!peer.outbound.empty() && peer.sent >= peer.outbound.front().size()) {
+      Frame& frame = peer.outbound.front();
+      peer.sent -= frame.size();
+      if (frame.kind != Kind::WHOLE)
+        peer.streaming = false;
+      if (frame.kind == Kind::LAST)
+        peer.streams.pop_front();
+      peer.outbound.pop_front();
+    }
+  }
+  return true;
+}
+
+size_t Networkable::pending(int recipient) const {
+  auto it = peers.find(recipient);
+  return it == peers.end() ? 0 : it->second.queued;
+}
+
+std::vector<NM::Message> Networkable::read_messages(int sender) {
+  Peer& peer = peers[sender];
+  vector<std::byte>& buffer = peer.inbound;
+  vector<NM::Message> batch;
+  bool hung_up = false;
+
+  // Frames are taken out after every chunk, so that only one is ever buffered
+  auto parse = [&] {
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+      uint64_t header;
+      size_t header_size = NM::read_varint(std::span<std::byte const>{buffer}.subspan(offset), header);
+      if (header_size == 0) {
+        hung_up |= buffer.size() - offset >= NM::MAX_VARINT;  // Not a varint, framing is lost
+        break;
+      }
+
+      uint64_t size = header >> 2;
+      auto kind     = static_cast<Kind>(header & 0b11);
+      if (kind > Kind::LAST || size > MAX_MESSAGE - peer.partial.size()) {
+        hung_up = true;
+        break;
+      }
+      if (buffer.size() - offset - header_size < size)
+        break;  // Rest of the frame has not arrived yet
+
+      auto payload = buffer.begin() + offset + header_size;
+      switch (kind) {
+        case Kind::WHOLE:
+          batch.push_back(NM::Message::deserialize({payload, payload + size}));
+          break;
+        case Kind::CHUNK:
+          peer.partial.insert(peer.partial.end(), payload, payload + size);
+          break;
+        case Kind::LAST:
+          peer.partial.insert(peer.partial.end(), payload, payload + size);
+          batch.push_back(NM::Message::deserialize(std::move(peer.partial)));
+          peer.partial = {};
+          break;
+        default:
+          break;
+      }
+      offset += header_size + size;
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + offset);
+  };
+
+  while (!hung_up) {
+    size_t filled = buffer.size();
+    buffer.resize(filled + READ_CHUNK);
+    ssize_t received = recv(sender, buffer.data() + filled, READ_CHUNK, MSG_DONTWAIT);
+    buffer.resize(filled + std::max<ssize_t>(received, 0));
+
+    if (received > 0) {
+      parse();
+      hung_up |= buffer.size() > NM::MAX_VARINT + MAX_MESSAGE;  // More than a frame left over
+      continue;
+    }
+    if (received == -1 && errno == EINTR)
+      continue;
+    hung_up = received == 0 || errno != EAGAIN;
+    break;
+  }
+
+  std::erase_if(batch, [&](const NM::Message& message) {
+    if (message.request() != Request::HELLO)
+      return false;
+    acceptHello(sender, message);
+    return true;
+  });
+
+  if (hung_up) {
+    forget(sender);
+    batch.emplace_back();
+  }
+  return batch;
+}
 
-  return NM::Message::deserialize(std::move(data));
+void Networkable::forget(int peer) {
+  peers.erase(peer);
 }
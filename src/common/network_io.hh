@@ -3,23 +3,107 @@
 #include <sys/socket.h>
 #include <signal.h>
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <string>
 #include <vector>
 #include <span>
+#include <array>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <bit>
+#include <concepts>
 
-constexpr uint16_t MAXSHORT = static_cast<uint16_t>(-1);  // 65535
 constexpr uint16_t PORT = 28772;
+constexpr size_t   MAX_MESSAGE = 64 << 20;  // 64 MiB, larger frames are a protocol error
 
 inline bool is_interrupted = false;
 
-//                   ╔═══════════════╗
-//                   ║ I/O Functions ║
-//                   ╚═══════════════╝
+//                   ╔══════════╗
+//                   ║ Integers ║
+//                   ╚══════════╝
 
 namespace NM {
   class Message;  // Forward declaration from serializer.hh
+
+  constexpr size_t MAX_VARINT = 10;  // Bytes needed by a 64-bit value
+
+  /**
+   * Writes a LEB128 varint: 7 bits per byte, low bits first, high bit
+   * set on every byte but the last.
+   *
+   * \param Value to encode.
+   * \param Destination, at least MAX_VARINT bytes long.
+   * \return Amount of bytes written.
+   */
+  constexpr inline size_t write_varint(uint64_t value, std::byte* out) {
+    size_t size = 0;
+    while (value >= 0x80) {
+      out[size++] = static_cast<std::byte>(value | 0x80);
+      value >>= 7;
+    }
+    out[size++] = static_cast<std::byte>(value);
+    return size;
+  }
+
+  /**
+   * Reads a LEB128 varint from the start of bytes.
+   *
+   * \param Bytes to read from.
+   * \param Decoded value, untouched if nothing was read.
+   * \return Amount of bytes read, 0 if the varint is incomplete or
+   *         longer than MAX_VARINT.
+   */
+  constexpr inline size_t read_varint(std::span<std::byte const> bytes, uint64_t& value) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < std::min(bytes.size(), MAX_VARINT); ++i) {
+      result |= static_cast<uint64_t>(bytes[i] & std::byte{0x7F}) << (7 * i);
+      if ((bytes[i] & std::byte{0x80}) == std::byte{0}) {
+        value = result;
+        return i + 1;
+      }
+    }
+    return 0;
+  }
+
+  /**
+   * Writes an integer little-endian with its exact width, as used for
+   * fixed-size fields on disk: the same bytes whatever the host order.
+   *
+   * \param Value to encode.
+   * \param Destination, at least sizeof(T) bytes long.
+   */
+  template<std::integral T>
+  inline void write_le(T value, std::byte* out) {
+    if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1)
+      value = std::byteswap(value);
+    std::memcpy(out, &value, sizeof(T));
+  }
+
+  /**
+   * Reads an integer written by write_le().
+   *
+   * \param Source, at least sizeof(T) bytes long.
+   * \return Value in host order.
+   */
+  template<std::integral T>
+  inline T read_le(const std::byte* in) {
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1)
+      value = std::byteswap(value);
+    return value;
+  }
 }
 
+//                   ╔═══════════════╗
+//                   ║ I/O Functions ║
+//                   ╚═══════════════╝
+
 class Networkable {
  public:
   enum class Request : uint8_t {
@@ -54,9 +138,23 @@ class Networkable {
     BACK_TO_LOBBY,
     RECORDING,
 
+    // Connection-specific
+    HELLO,
+    CLOCK,
+
     R_SENTINEL
   };
 
+  /**
+   * Wire encodings, oldest first, agreed on by both sides with HELLO.
+   * Numbered as when the 8-byte aligned encoding came first.
+   */
+  enum class Encoding : uint8_t {
+    COMPACT = 1,  // Varints, 1-byte enums, packed coordinates
+
+    LATEST = COMPACT
+  };
+
   struct ILLEGALCHARACTERS {
     static constexpr char SPACE = ' ';
   };
@@ -64,10 +162,181 @@ class Networkable {
  protected:
   // Errno is set in case of errors
 
-  void write_message(int recipient, NM::Message&& message);
-  NM::Message read_message(int sender);
+  /**
+   * Queues a message for the recipient and sends as much of the queue
+   * as the socket accepts right away. Whatever does not fit is kept,
+   * partial frames included, until flush() is called on POLLOUT.
+   * Messages larger than CHUNK_SIZE are streamed in chunks, one chunk
+   * at a time, so that smaller messages queued after them are not held
+   * back until the whole body is sent.
+   *
+   * \param Socket of the recipient.
+   * \param Message to send.
+   * \return false if the connection is broken.
+   */
+  bool write_message(int recipient, NM::Message&& message);
+
+  /**
+   * Sends the same messages to every recipient. Each is encoded once and
+   * the buffer queued for all of them, so the cost of encoding does not
+   * grow with their number. Each
+   * recipient is flushed once, after all of its messages are queued.
+   *
+   * \param Sockets of the recipients.
+   * \param Messages to send, in order.
+   * \return Recipients whose connection is broken.
+   */
+  [[nodiscard]] std::vector<int> broadcast(std::span<int const> recipients, std::span<NM::Message const> messages);
+
+  /**
+   * Offers the latest encoding to a newly connected peer. Messages go
+   * out in the compact encoding until the peer's HELLO arrives, which
+   * read_messages() handles without returning it.
+   *
+   * \param Socket of the peer.
+   * \return false if the connection is broken.
+   */
+  bool greet(int peer);
+
+  /**
+   * Stamps a client's ClockSync probe with this side's monotonic time.
+   *
+   * \param CLOCK message received.
+   * \return Answer to send back, empty if it was not a probe.
+   */
+  [[nodiscard]] static NM::Message answerClock(const NM::Message& probe);
+
+  /**
+   * Sends queued frames, several per syscall, until the queue is
+   * empty or the socket would block.
+   *
+   * \param Socket of the recipient.
+   * \return false if the connection is broken.
+   */
+  bool flush(int recipient);
+
+  /**
+   * Queue depth of a peer, to apply backpressure or to decide
+   * whether to poll for POLLOUT.
+   *
+   * \param Socket of the recipient.
+   * \return Amount of bytes not yet accepted by the socket.
+   */
+  [[nodiscard]] size_t pending(int recipient) const;
+
+  /**
+   * Reads everything the socket has ready without blocking and returns
+   * every complete message found, in order. A partially received frame,
+   * or the chunks of a message still being streamed, are kept in the
+   * sender's reassembly buffers until the rest arrives.
+   * If the sender hung up or broke the framing, the batch ends with an
+   * empty message.
+   *
+   * \param Socket with pending input.
+   * \return Batch of complete messages, possibly empty.
+   */
+  [[nodiscard]] std::vector<NM::Message> read_messages(int sender);
+
+  /**
+   * Drops the buffered state of a closed connection.
+   *
+   * \param Socket that is being closed.
+   */
+  void forget(int peer);
+
+ private:
+  static constexpr size_t READ_CHUNK   = 16384;
+  static constexpr size_t CHUNK_SIZE   = 16384;  // Largest body sent in a single frame
+  static constexpr size_t WRITE_FRAMES = 64;     // Frames gathered per sendmsg
+
+  // Frame header: varint of (payload size << 2 | Kind)
+  enum class Kind : uint8_t {
+    WHOLE,  // Complete message
+    CHUNK,  // Part of a streamed message, more follows
+    LAST,   // Final part of a streamed message
+  };
+
+  // Encoded message, immutable once queued
+  using Buffer = std::shared_ptr<std::vector<std::byte> const>;
+
+  struct Frame {
+    std::array<std::byte, NM::MAX_VARINT> header;
+    uint8_t header_size;
+    Kind kind;
+    Buffer body;                         // Bytes of a whole message, shared by a broadcast's recipients
+    std::span<std::byte const> payload;  // Bytes to send, body or a slice of a streamed message
+
+    [[nodiscard]] inline size_t size() const { return header_size + payload.size(); }
+  };
+
+  struct Stream {
+    Buffer data;
+    size_t framed = 0;  // Bytes already cut into chunks
+  };
+
+  struct Peer {
+    std::vector<std::byte> inbound;
+    std::vector<std::byte> partial;  // Chunks of the message being received
+    std::deque<Frame> outbound;
+    std::deque<Stream> streams;      // Large messages, streamed one at a time
+    bool streaming = false;          // A chunk of streams.front() is in outbound
+    bool greeted   = false;          // HELLO was sent to this peer
+    Encoding encoding = Encoding::COMPACT;
+    size_t sent   = 0;               // Bytes of outbound.front() already written
+    size_t queued = 0;               // Bytes of outbound and streams not yet written
+  };
+
+  static Frame makeFrame(Kind kind, std::span<std::byte const> payload);
+  void queue(Peer& peer, Buffer data);
+  void queueChunk(Peer& peer);
+  void acceptHello(int sender, const NM::Message& hello);
+
+  std::unordered_map<int, Peer> peers;
+
+ public:
+  /**
+   * Buffered state of one connection, as moved between Networkables.
+   */
+  using PeerState = decltype(peers)::node_type;
+
+ protected:
+  /**
+   * Hands the buffered state of a connection over to another
+   * Networkable, typically one running on another thread, without
+   * copying: queued frames and partial input go along with it.
+   *
+   * \param Socket to stop handling here.
+   * \return Its state, to give to adopt().
+   */
+  [[nodiscard]] inline PeerState release(int peer) { return peers.extract(peer); }
+
+  /**
+   * Takes over a connection given up by release().
+   *
+   * \param State of the connection, empty if it had no state yet.
+   */
+  inline void adopt(PeerState&& state) {
+    if (!state.empty())
+      peers.insert(std::move(state));
+  }
 };
 
+//                   ╔════════════════╗
+//                   ║ Socket Options ║
+//                   ╚════════════════╝
+
+/**
+ * Sends small frames as soon as they are written, instead of holding
+ * them back for Nagle's algorithm until the previous one is acknowledged.
+ *
+ * \param Connected TCP socket.
+ * \return -1 on error, with errno set.
+ */
+inline int set_nodelay(int fd) {
+  int enable = 1;
+  return setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+
 //                   ╔═════════════════╗
 //                   ║ Signal Handling ║
 //                   ╚═════════════════╝
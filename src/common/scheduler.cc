@@ -0,0 +1,72 @@
+#include "scheduler.hh"
+
+namespace {
+  // Scheduler and index of the worker running on this thread, if any
+  thread_local const NM::Scheduler* current_scheduler = nullptr;
+  thread_local size_t current_worker = 0;
+}
+
+NM::Scheduler::Scheduler(size_t count) {
+  workers.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+    workers.push_back(std::make_unique<Worker>());
+  // Started once all deques exist, as any worker may steal from any other
+  for (size_t i = 0; i < count; ++i)
+    workers[i]->thread = std::jthread([this, i] { run(i); });
+}
+
+NM::Scheduler::~Scheduler() {
+  stopping.store(true);
+  queued.fetch_add(1);  // Wakes sleepers, who see nothing to take and leave
+  queued.notify_all();
+  for (auto& worker : workers)
+    worker->thread.join();
+}
+
+void NM::Scheduler::submit(Task&& task) {
+  size_t index = current_scheduler == this ? current_worker : next.fetch_add(1, std::memory_order_relaxed) % workers.size();
+  {
+    std::lock_guard lock(workers[index]->mutex);
+    workers[index]->tasks.push_back(std::move(task));
+  }
+  queued.fetch_add(1);
+  queued.notify_one();
+}
+
+NM::Task NM::Scheduler::take(size_t index) {
+  {
+    Worker& own = *workers[index];
+    std::lock_guard lock(own.mutex);
+    if (!own.tasks.empty())
+      return own.tasks.pop_back();
+  }
+
+  for (size_t i = 1; i < workers.size(); ++i) {
+    Worker& victim = *workers[(index + i) % workers.size()];
+    std::lock_guard lock(victim.mutex);
+    if (!victim.tasks.empty())
+      return victim.tasks.pop_front();
+  }
+  return {};
+}
+
+void NM::Scheduler::run(size_t index) {
+  current_scheduler = this;
+  current_worker    = index;
+
+  while (true) {
+    if (Task task = take(index)) {
+      queued.fetch_sub(1);
+      task();
+      continue;
+    }
+
+    uint32_t seen = queued.load();
+    if (stopping.load())
+      return;  // Nothing left anywhere
+    if (seen == 0)
+      queued.wait(0);
+    else
+      std::this_thread::yield();  // Counted but not pushed yet, or being taken
+  }
+}
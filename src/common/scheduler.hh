@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace NM {
+  /**
+   * Concept of a function that does not return anything.
+   */
+  template<typename F, typename... Args>
+  concept VoidReturn = std::is_invocable_v<F&&, Args&&...> && std::same_as<std::invoke_result_t<F&&, Args&&...>, void>;
+
+  /**
+   * Move-only void() callable stored inline, one cache line in all:
+   * queuing a task never allocates. Callables too large to fit should
+   * capture a pointer to their data instead.
+   */
+  class Task {
+   public:
+    static constexpr size_t CAPACITY = 56;
+
+    Task() = default;
+
+    template<typename F>
+      requires (!std::same_as<std::remove_cvref_t<F>, Task>) && VoidReturn<std::decay_t<F>&>
+    Task(F&& callable) {
+      using Stored = std::decay_t<F>;
+      static_assert(sizeof(Stored) <= CAPACITY && alignof(Stored) <= alignof(std::max_align_t),
+                    "Task captures too much, capture a pointer to it instead");
+      static_assert(std::is_nothrow_move_constructible_v<Stored>, "Tasks are moved between queues");
+
+      ::new (storage) Stored(std::forward<F>(callable));
+      ops = &OPS<Stored>;
+    }
+
+    Task(Task&& other) noexcept { take(other); }
+
+    Task& operator=(Task&& other) noexcept {
+      if (this != &other) {
+        reset();
+        take(other);
+      }
+      return *this;
+    }
+
+    ~Task() { reset(); }
+
+    explicit operator bool() const { return ops != nullptr; }
+
+    void operator()() { ops->invoke(storage); }
+
+    Task(const Task&)            = delete;
+    Task& operator=(const Task&) = delete;
+
+   private:
+    struct Ops {
+      void (*invoke)(std::byte*);
+      void (*move)(std::byte* to, std::byte* from);  // Also destroys the source
+      void (*destroy)(std::byte*);
+    };
+
+    template<typename F>
+    static constexpr Ops OPS{
+      [](std::byte* self) { (*std::launder(reinterpret_cast<F*>(self)))(); },
+      [](std::byte* to, std::byte* from) {
+        F* source = std::launder(reinterpret_cast<F*>(from));
+        ::new (to) F(std::move(*source));
+        source->~F();
+      },
+      [](std::byte* self) { std::launder(reinterpret_cast<F*>(self))->~F(); },
+    };
+
+    alignas(std::max_align_t) std::byte storage[CAPACITY];
+    const Ops* ops = nullptr;
+
+    void take(Task& other) {
+      if (other.ops) {
+        other.ops->move(storage, other.storage);
+        ops = std::exchange(other.ops, nullptr);
+      }
+    }
+
+    void reset() {
+      if (ops)
+        std::exchange(ops, nullptr)->destroy(storage);
+    }
+  };
+
+  /**
+   * Pool of worker threads for work kept off the network path, such
+   * as the server hashing passwords.
+   *
+   * Each worker has its own deque. Tasks pushed by a worker go on its own
+   * deque, which it empties newest first while the cache is warm; other
+   * tasks are dealt round-robin. A worker out of tasks steals the oldest
+   * ones of the others before going to sleep. Tasks always run outside of
+   * any lock, so pushing never waits for one to finish.
+   */
+  class Scheduler {
+   public:
+    /**
+     * Starts the workers, which sleep until there is work.
+     *
+     * \param Number of workers, one per core by default.
+     */
+    explicit Scheduler(size_t workers = std::max(std::thread::hardware_concurrency(), 1u));
+
+    /**
+     * Runs every task already pushed, then joins the workers.
+     */
+    ~Scheduler();
+
+    /**
+     * Queues a task for any worker to run.
+     * Member functions must be called together with owning object.
+     * Arguments are copied or moved into the task.
+     *
+     * \param Function with void return type.
+     * \param Sequence of arguments for function.
+     */
+    template<typename F, typename... Args>
+      requires VoidReturn<F, Args...>
+    void push(F&& task, Args&&... args) {
+      if constexpr (sizeof...(Args) == 0)
+        submit(Task(std::forward<F>(task)));
+      else
+        submit(Task([task = std::forward<F>(task), ...args = std::forward<Args>(args)]() mutable {
+          std::invoke(task, args...);
+        }));
+    }
+
+    [[nodiscard]] inline size_t size() const { return workers.size(); }
+
+    Scheduler(Scheduler&&)      = delete;
+    Scheduler(const Scheduler&) = delete;
+
+   private:
+    /**
+     * Double-ended queue over a ring that only ever grows: once it is
+     * as large as the busiest moment, queuing costs no allocation.
+     */
+    class Ring {
+     public:
+      [[nodiscard]] inline bool empty() const { return count == 0; }
+
+      void push_back(Task&& task) {
+        if (count == slots.size())
+          grow();
+        slots[(head + count++) & (slots.size() - 1)] = std::move(task);
+      }
+
+      [[nodiscard]] Task pop_back() { return std::move(slots[(head + --count) & (slots.size() - 1)]); }
+
+      [[nodiscard]] Task pop_front() {
+        --count;
+        return std::move(slots[std::exchange(head, (head + 1) & (slots.size() - 1))]);
+      }
+
+     private:
+      std::vector<Task> slots;  // Size is a power of two
+      size_t head  = 0;
+      size_t count = 0;
+
+      void grow() {
+        std::vector<Task> larger(std::max<size_t>(slots.size() * 2, 64));
+        for (size_t i = 0; i < count; ++i)
+          larger[i] = std::move(slots[(head + i) & (slots.size() - 1)]);
+        slots = std::move(larger);
+        head  = 0;
+      }
+    };
+
+    // Padded so that workers locking their own deque do not share a cache line
+    struct alignas(64) Worker {
+      std::mutex mutex;  // Held only to push or take, never while running
+      Ring tasks;
+      std::jthread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<uint32_t> queued = 0;  // Tasks not taken yet, which sleeping workers wait on
+    std::atomic<size_t> next     = 0;  // Round-robin for pushes from other threads
+    std::atomic<bool> stopping   = false;
+
+    void submit(Task&& task);
+    void run(size_t index);
+
+    /**
+     * \return A task from the worker's own deque, else stolen from another.
+     */
+    [[nodiscard]] Task take(size_t index);
+  };
+}
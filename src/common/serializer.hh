@@ -1,8 +1,5 @@
 ﻿#pragma once
 
-#include <endian.h>
-#if __BYTE_ORDER == __LITTLE_ENDIAN && __x86_64__
-
 #include <type_traits>
 #include <vector>
 #include <string>
@@ -11,6 +8,11 @@
 #include <span>
 #include <tuple>
 #include <iostream>
+#include <cstring>
+#include <iterator>
+#include <utility>
+#include <ranges>
+#include <initializer_list>
 
 #include "network_io.hh"
 #include "board_common.hh"
@@ -32,9 +34,8 @@ namespace NM {
   /**
    * Exception to be thrown when deserialization
    * encounters a problem.
-   * 
-   * Currently unused. Throw it in from_bytes functions
-   * and catch in extract() for extra safety.
+   *
+   * Thrown by the from-bytes helpers, caught in extract().
    */
   class MangledBytesError : public std::runtime_error {
    public:
@@ -42,15 +43,166 @@ namespace NM {
       : std::runtime_error("Bytestream is mangled: " + what) {}
   };
 
+  /**
+   * Cursor appending bytes to a buffer that was sized beforehand.
+   * A default-constructed Writer only counts, which is how the
+   * exact size of a message is computed before allocating it.
+   */
+  class Writer {
+   public:
+    constexpr Writer() = default;
+    explicit constexpr Writer(std::span<std::byte> buffer) : out{buffer.data()} {}
+
+    inline void write(std::span<std::byte const> bytes) {
+      if (out && !bytes.empty())
+        std::memcpy(out + offset, bytes.data(), bytes.size());
+      offset += bytes.size();
+    }
+
+    [[nodiscard]] constexpr inline size_t size() const { return offset; }
+
+   private:
+    std::byte* out = nullptr;
+    size_t offset  = 0;
+  };
+
+  /**
+   * Compact encoding of a field type, defined at the end of this file.
+   */
+  template<typename T>
+  struct Codec;
+
+  template<typename R, typename T>
+  concept RangeOf = std::ranges::input_range<R> && std::convertible_to<std::ranges::range_reference_t<R>, T>;
+
+  /**
+   * Copies a range into a vector with a single allocation when its
+   * size is known, so decoded views are only walked once.
+   */
+  template<typename T, std::ranges::input_range R>
+  constexpr std::vector<T> collect(R&& range) {
+    std::vector<T> vec;
+    if constexpr (std::ranges::sized_range<R>)
+      vec.reserve(std::ranges::size(range));
+    for (auto&& element : range)
+      vec.emplace_back(element);
+    return vec;
+  }
+
+  /**
+   * Read-only sequence of length-prefixed strings as laid out in a
+   * message body. Elements are string_views into that body.
+   * Bounds are checked once when the list is deserialized.
+   */
+  class StringList {
+   public:
+    class iterator {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type        = std::string_view;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = void;
+      using reference         = std::string_view;
+
+      constexpr iterator() = default;
+      constexpr iterator(const std::byte* at, const std::byte* end) : at{at}, end{end} {}
+
+      std::string_view operator*() const {
+        uint64_t size   = 0;
+        size_t   prefix = read_varint({at, end}, size);
+        return {reinterpret_cast<const char*>(at + prefix), size};
+      }
+
+      iterator& operator++() {
+        uint64_t size   = 0;
+        size_t   prefix = read_varint({at, end}, size);
+        at += prefix + size;
+        return *this;
+      }
+      iterator operator++(int) { iterator old = *this; ++*this; return old; }
+
+      bool operator==(const iterator&) const = default;
+
+     private:
+      const std::byte* at  = nullptr;
+      const std::byte* end = nullptr;
+    };
+
+    constexpr StringList() = default;
+    constexpr StringList(std::span<std::byte const> bytes, size_t count) : bytes{bytes}, count{count} {}
+
+    [[nodiscard]] constexpr inline iterator begin() const { return {bytes.data(), bytes.data() + bytes.size()}; }
+    [[nodiscard]] constexpr inline iterator end()   const { return {bytes.data() + bytes.size(), bytes.data() + bytes.size()}; }
+    [[nodiscard]] constexpr inline size_t   size()  const { return count; }
+    [[nodiscard]] constexpr inline bool     empty() const { return count == 0; }
+
+   private:
+    std::span<std::byte const> bytes;
+    size_t count = 0;
+  };
+
+  /**
+   * Read-only sequence of compactly encoded elements as laid out in a
+   * message body. Elements are decoded on access with Codec<T>.
+   * Bounds are checked once when the list is deserialized.
+   */
+  template<typename T>
+  class PackedList {
+   public:
+    class iterator {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type        = T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = void;
+      using reference         = T;
+
+      constexpr iterator() = default;
+      constexpr iterator(const std::byte* at, const std::byte* end) : at{at}, end{end} {}
+
+      T operator*() const {
+        uint64_t offset = 0;
+        return Codec<T>::decode({at, end}, offset);
+      }
+
+      iterator& operator++() {
+        uint64_t offset = 0;
+        Codec<T>::skip({at, end}, offset);
+        at += offset;
+        return *this;
+      }
+      iterator operator++(int) { iterator old = *this; ++*this; return old; }
+
+      bool operator==(const iterator&) const = default;
+
+     private:
+      const std::byte* at  = nullptr;
+      const std::byte* end = nullptr;
+    };
+
+    constexpr PackedList() = default;
+    constexpr PackedList(std::span<std::byte const> bytes, size_t count) : bytes{bytes}, count{count} {}
+
+    [[nodiscard]] constexpr inline iterator begin() const { return {bytes.data(), bytes.data() + bytes.size()}; }
+    [[nodiscard]] constexpr inline iterator end()   const { return {bytes.data() + bytes.size(), bytes.data() + bytes.size()}; }
+    [[nodiscard]] constexpr inline size_t   size()  const { return count; }
+    [[nodiscard]] constexpr inline bool     empty() const { return count == 0; }
+
+   private:
+    std::span<std::byte const> bytes;
+    size_t count = 0;
+  };
+
   /**
    * Message class intended to be serialized and sent
    * to remotes. Body is optional and can be deserialized 
    * into defined classes.
    */
   class Message {
-    using Request = Networkable::Request;
+    using Request  = Networkable::Request;
+    using Encoding = Networkable::Encoding;
 
-    enum class BodyType : uint64_t {
+    enum class BodyType : uint8_t {
       NOTHING,
       CREDENTIALS,
       RELATION_UPDATE,
@@ -70,16 +222,27 @@ namespace NM {
       CLIENT_FIRE,
       SERVER_FIRE,
       GAME_END,
-      RECORDING
+      RECORDING,
+      HELLO,
+      CLOCK_SYNC,
+      DEADLINE,
+      B_SENTINEL
     };
 
+    // Compact header: request with the high bit set, then the body type if there is a body.
+    static constexpr std::byte COMPACT_FLAG{0x80};
+    static constexpr size_t REQUEST_SIZE = sizeof(uint8_t);
+    static constexpr size_t HEADER_SIZE  = sizeof(uint8_t) * 2;
+
     bool is_empty;
     Request req;
     BodyType type;
-    std::vector<std::byte> body;
+    std::vector<std::byte> frame;  // Header followed by the body, as sent on the wire
 
-    constexpr Message(Request&& req, BodyType&& type, std::vector<std::byte>&& body)
-      : is_empty{false}, req{req}, type{type}, body{body} {}
+    constexpr Message(Request req, BodyType type, std::vector<std::byte>&& frame)
+      : is_empty{false}, req{req}, type{type}, frame{std::move(frame)} {}
+
+    void writeHeader(Writer& writer) const;
 
    public:
     using Pair = std::pair<int, Message>;
@@ -89,17 +252,44 @@ namespace NM {
 
     [[nodiscard]] constexpr inline Request request() const { return req; }
 
+    /**
+     * Hands over the encoded frame.
+     *
+     * \param Message to send.
+     * \return Frame as sent on the wire.
+     */
     [[nodiscard]] static std::vector<std::byte> serialize(Message&& message);
+
+    /**
+     * \return Message of the frame, empty if it is not a compact frame.
+     */
     [[nodiscard]] static Message              deserialize(std::vector<std::byte>&& data);
 
     [[nodiscard]] constexpr inline bool empty() const { return is_empty; }
 
-    Message(Request req, Serializable auto&& content) 
-                         : is_empty{false}, req{req}, type{content.getType()}, body{content.serialize()} {}
-    Message(Request req) : is_empty{false}, req{req}, type{BodyType::NOTHING}, body{} {}
-    constexpr Message()  : is_empty{true}, req{}, type{}, body{} {}
+    /**
+     * Encodes the content right away, header included, into a single
+     * buffer of the exact size. serialize() then hands that buffer over.
+     */
+    template<typename T>
+      requires Serializable<std::remove_cvref_t<T>>
+    Message(Request req, T&& content) : is_empty{false}, req{req}, type{content.getType()} {
+      using Body = std::remove_cvref_t<T>;
+      Writer sizer;
+      Codec<Body>::encode(sizer, content);
+      frame.resize(HEADER_SIZE + sizer.size());
+
+      Writer writer{frame};
+      writeHeader(writer);
+      Codec<Body>::encode(writer, content);
+    }
+    Message(Request req);
+    constexpr Message()  : is_empty{true}, req{}, type{}, frame{} {}
 
-    std::span<std::byte const> get_body() const { return body; }
+    std::span<std::byte const> get_body() const {
+      return frame.size() > HEADER_SIZE ? std::span<std::byte const>{frame}.subspan(HEADER_SIZE)
+                                        : std::span<std::byte const>{};
+    }
 
     /**
      * Deserialize contents from message body.
@@ -112,7 +302,28 @@ namespace NM {
       try {
         if (T::getType() == type) {
           uint64_t offset = 0;
-          return T::deserialize(body, offset);
+          return Codec<T>::decode(get_body(), offset);
+        }
+      } catch (const MangledBytesError& e) {
+        std::cerr << "Deserialization error: " << e.what() << std::endl;
+      }
+      return std::nullopt;
+    }
+
+    /**
+     * Same as extract(), but strings and arrays are views into this
+     * message instead of copies. The view must not outlive the message.
+     * Only classes defining a View support this, its members being the
+     * decoded fields in data() order.
+     *
+     * \return std::optional view of valid type.
+     */
+    template<Serializable T>
+    std::optional<typename T::View> extract_view() const {
+      try {
+        if (T::getType() == type) {
+          uint64_t offset = 0;
+          return std::make_from_tuple<typename T::View>(Codec<T>::fields(get_body(), offset));
         }
       } catch (const MangledBytesError& e) {
         std::cerr << "Deserialization error: " << e.what() << std::endl;
@@ -124,8 +335,68 @@ namespace NM {
     //    ║ Message Object Definitions ║
     //    ╚════════════════════════════╝
 
+    /**
+     * Encoding offered when connecting, or picked in reply.
+     */
+    class Hello : serializable_t {
+     public:
+      constexpr Hello(Encoding version) : version{version} {}
+
+      [[nodiscard]] constexpr inline auto data() const { return version; }
+
+     private:
+      Encoding version;
+
+      friend Message;
+        constexpr static inline BodyType getType() { return BodyType::HELLO; }
+    };
+
+    /**
+     * Probe for the offset between both monotonic clocks, in microseconds
+     * since their epoch: the client's time when sending it, then the
+     * server's when answering, zero until it does.
+     */
+    class ClockSync : serializable_t {
+     public:
+      constexpr ClockSync(chrono::microseconds sent, chrono::microseconds answered = {})
+        : sent{sent}, answered{answered} {}
+
+      [[nodiscard]] constexpr inline auto data() const { return std::tie(sent, answered); }
+
+     private:
+      chrono::microseconds sent;
+      chrono::microseconds answered;
+
+      friend Message;
+        constexpr static inline BodyType getType() { return BodyType::CLOCK_SYNC; }
+    };
+
+    /**
+     * When a player's game and turn time run out, on the server's monotonic
+     * clock as ClockSync counts it, zero for a time that does not run.
+     */
+    class Deadline : serializable_t {
+     public:
+      constexpr Deadline(chrono::microseconds game, chrono::microseconds turn)
+        : game{game}, turn{turn} {}
+
+      [[nodiscard]] constexpr inline auto data() const { return std::tie(game, turn); }
+
+     private:
+      chrono::microseconds game;
+      chrono::microseconds turn;
+
+      friend Message;
+        constexpr static inline BodyType getType() { return BodyType::DEADLINE; }
+    };
+
     class Credentials : serializable_t {
      public:
+      struct View {
+        std::string_view name;
+        std::string_view password;
+      };
+
       constexpr Credentials(std::string_view name, std::string_view password)
         : name{name}, password{password} {}
 
@@ -137,8 +408,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::CREDENTIALS; }
-        std::vector<std::byte> serialize() const;
-        static Credentials   deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class Relationship : serializable_t {
@@ -153,6 +422,12 @@ namespace NM {
         SENDINGGAME
       };
 
+      struct View {
+        std::string_view you;
+        std::string_view other;
+        Kind k;
+      };
+
       constexpr Relationship(std::string_view you, std::string_view other, Kind k)
         : you{you}, other{other}, k{k} {}
 
@@ -165,28 +440,44 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::RELATION_UPDATE; }
-        std::vector<std::byte> serialize() const;
-        static Relationship  deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
+    /**
+     * A page of the chat with a friend. Asked for with an empty log and
+     * the line before which to read, 0 for the latest lines; answered with
+     * the lines and the number of the first one, 0 once nothing is older.
+     */
     class ChatLog : serializable_t {
      public:
-       constexpr ChatLog(std::string_view recipient, std::span<std::string const> log) : recipient{recipient}, log{log.begin(), log.end()} {}
+      struct View {
+        std::string_view recipient;
+        StringList log;
+        uint64_t cursor;
+      };
 
-      [[nodiscard]] constexpr inline auto data() const { return std::tie(recipient, log); }
+      template<RangeOf<std::string_view> R = std::initializer_list<std::string_view>>
+      constexpr ChatLog(std::string_view recipient, R&& log, uint64_t cursor = 0)
+        : recipient{recipient}, log{collect<std::string>(log)}, cursor{cursor} {}
+
+      [[nodiscard]] constexpr inline auto data() const { return std::tie(recipient, log, cursor); }
 
      private:
       std::string recipient;
       std::vector<std::string> log;
+      uint64_t cursor;
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::CHAT_LOG; }
-        std::vector<std::byte> serialize() const;
-        static ChatLog       deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class ChatUpdate : serializable_t {
      public:
+      struct View {
+        std::string_view sender;
+        std::string_view receiver;
+        std::string_view line;
+      };
+
       constexpr ChatUpdate(std::string_view sender, std::string_view receiver, std::string_view line)
         : sender{sender}, receiver{receiver}, line{line} {}
 
@@ -199,25 +490,25 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::CHAT_UPDATE; }
-        std::vector<std::byte> serialize() const;
-        static ChatUpdate    deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class Account : serializable_t {
      public:
       constexpr Account(std::string_view username) : username{username} {}
 
+      template<RangeOf<std::string_view> F = std::initializer_list<std::string_view>, RangeOf<std::string_view> I = std::initializer_list<std::string_view>,
+               RangeOf<std::string_view> O = std::initializer_list<std::string_view>, RangeOf<std::string_view> G = std::initializer_list<std::string_view>>
       constexpr
       Account(std::string_view username,
-              std::span<std::string const> friends,
-              std::span<std::string const> inbound,
-              std::span<std::string const> outbound,
-              std::span<std::string const> game_requests) // Maybe add construct /w game_request ? 
+              F&& friends,
+              I&& inbound,
+              O&& outbound,
+              G&& game_requests) // Maybe add construct /w game_request ? 
         : username{username},
-          friends{friends.begin(), friends.end()},
-          inbound{inbound.begin(), inbound.end()},
-          outbound{outbound.begin(), outbound.end()},
-          game_requests{game_requests.begin(), game_requests.end()} {}
+          friends{collect<std::string>(friends)},
+          inbound{collect<std::string>(inbound)},
+          outbound{collect<std::string>(outbound)},
+          game_requests{collect<std::string>(game_requests)} {}
 
       void pushRelationships(std::span<std::string const> friends,
                              std::span<std::string const> inbound,
@@ -235,8 +526,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::ACCOUNT; }
-        std::vector<std::byte> serialize() const;
-        static Account       deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class Matches : serializable_t {
@@ -250,7 +539,8 @@ namespace NM {
 
       constexpr Matches() : matches{} {}
 
-      constexpr Matches(std::span<Match const> matches) : matches{matches.begin(), matches.end()} {}
+      template<RangeOf<Match> R = std::initializer_list<Match>>
+      constexpr Matches(R&& matches) : matches{collect<Match>(matches)} {}
 
       constexpr inline void push_back(const auto& match) { matches.push_back(match); }
 
@@ -259,6 +549,9 @@ namespace NM {
       constexpr inline void shrink_to_fit() { matches.shrink_to_fit(); }
 
       constexpr inline std::vector<Match> getMatch() { return matches; }
+
+      [[nodiscard]] constexpr inline const auto& data() const { return matches; }
+
      private:
       std::vector<Match> matches;
 
@@ -266,8 +559,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::MATCHES; }
-        std::vector<std::byte> serialize() const;
-        static Matches       deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class HostLobby : serializable_t {
@@ -288,8 +579,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::HOST_MATCH; }
-        std::vector<std::byte> serialize() const;
-        static HostLobby     deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class SlotLobby : serializable_t {
@@ -301,6 +590,11 @@ namespace NM {
         QUITTING
       };
 
+      struct View {
+        std::string_view name;
+        Slot s;
+      };
+
       constexpr SlotLobby(std::string_view name, Slot s = Slot::SPECTATOR) : name{name}, s{s} {}
 
       [[nodiscard]] constexpr inline auto data() const { return std::tie(name, s); }
@@ -311,8 +605,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::CHANGE_SLOT; }
-        std::vector<std::byte> serialize() const;
-        static SlotLobby     deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class LobbyParameters : serializable_t {
@@ -322,6 +614,9 @@ namespace NM {
       constexpr LobbyParameters(Lobby::parameter_t data)
         : game_time{std::get<0>(data)}, turn_time{std::get<1>(data)}, tt{std::get<2>(data)}, gt{std::get<3>(data)} { }
 
+      constexpr LobbyParameters(chrono::seconds game_time, chrono::seconds turn_time, Timer::Type tt, GameModel::GameMode gt)
+        : game_time{game_time}, turn_time{turn_time}, tt{tt}, gt{gt} { }
+
       [[nodiscard]] constexpr inline auto data() const { return std::tie(game_time, turn_time, tt, gt); }
 
      private:
@@ -332,14 +627,13 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::LOBBY_DETAILS; }
-        std::vector<std::byte>   serialize() const;
-        static LobbyParameters deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class JoinLobby : serializable_t {
      public:
-      constexpr JoinLobby(HostLobby lobby, LobbyParameters params, std::span<SlotLobby const> clients = {})
-        : lobby{lobby}, params{params}, clients{clients.begin(), clients.end()} { }
+      template<RangeOf<SlotLobby> R = std::initializer_list<SlotLobby>>
+      constexpr JoinLobby(HostLobby lobby, LobbyParameters params, R&& clients = {})
+        : lobby{lobby}, params{params}, clients{collect<SlotLobby>(clients)} { }
 
       [[nodiscard]] constexpr inline auto data() const { return std::tie(lobby, params, clients); }
 
@@ -352,8 +646,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::JOIN_MATCH; }
-        std::vector<std::byte> serialize() const;
-        static JoinLobby     deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     //    ╔═══════════════════════╗
@@ -371,8 +663,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::FACTION; }
-        std::vector<std::byte> serialize() const;
-        static Faction       deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class BoatSelection : serializable_t {
@@ -386,14 +676,13 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::BOAT_SELECTION; }
-        std::vector<std::byte> serialize() const;
-        static BoatSelection deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class Confirmation : serializable_t {
      public:
-      constexpr Confirmation(std::span<BoardCoordinates const> coordinates, int boat_id, Boat::Type type)
-        : coordinates{coordinates.begin(), coordinates.end()}, boat_id{boat_id}, type{type} { }
+      template<RangeOf<BoardCoordinates> R = std::initializer_list<BoardCoordinates>>
+      constexpr Confirmation(R&& coordinates, int boat_id, Boat::Type type)
+        : coordinates{collect<BoardCoordinates>(coordinates)}, boat_id{boat_id}, type{type} { }
 
       [[nodiscard]] constexpr inline auto data() const { return std::tie(coordinates, boat_id, type); }
 
@@ -404,8 +693,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::CONFIRMATION; }
-        std::vector<std::byte> serialize() const;
-        static Confirmation  deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class StartCombat : serializable_t {
@@ -419,8 +706,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::START_COMBAT; }
-        std::vector<std::byte> serialize() const;
-        static StartCombat   deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class AbilitySelection : serializable_t {
@@ -434,14 +719,13 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::ABILITY_SELECTION; }
-        std::vector<std::byte>    serialize() const;
-        static AbilitySelection deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class ClientFire : serializable_t {
      public:
-      constexpr ClientFire(std::span<BoardCoordinates const> coordinates, Ability::Type type)
-        : coordinates{coordinates.begin(), coordinates.end()}, type{type} {}
+      template<RangeOf<BoardCoordinates> R = std::initializer_list<BoardCoordinates>>
+      constexpr ClientFire(R&& coordinates, Ability::Type type)
+        : coordinates{collect<BoardCoordinates>(coordinates)}, type{type} {}
 
       [[nodiscard]] constexpr inline auto data() const { return std::tie(coordinates, type); }
 
@@ -451,8 +735,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::CLIENT_FIRE; }
-        std::vector<std::byte> serialize() const;
-        static ClientFire    deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class ServerFire : serializable_t {
@@ -463,8 +745,17 @@ namespace NM {
         int id;
         State new_state;
       };
-      constexpr ServerFire(std::span<Cell const> cells, bool board, bool turn, int new_energy)
-        : cells{cells.begin(), cells.end()}, your_board{board}, your_turn{turn}, new_energy{new_energy} { }
+
+      struct View {
+        PackedList<Cell> cells;
+        bool your_board;
+        bool your_turn;
+        int new_energy;
+      };
+
+      template<RangeOf<Cell> R = std::initializer_list<Cell>>
+      constexpr ServerFire(R&& cells, bool board, bool turn, int new_energy)
+        : cells{collect<Cell>(cells)}, your_board{board}, your_turn{turn}, new_energy{new_energy} { }
 
       [[nodiscard]] constexpr inline auto data() const { return std::tie(cells, your_board, your_turn, new_energy); }
 
@@ -476,8 +767,6 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::SERVER_FIRE; }
-        std::vector<std::byte> serialize() const;
-        static ServerFire    deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class GameEnd : serializable_t {
@@ -491,25 +780,21 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::GAME_END; }
-        std::vector<std::byte> serialize() const;
-        static GameEnd       deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
 
     class Recording : serializable_t {
      public:
       constexpr Recording() = default;
-      constexpr Recording(std::string_view left, std::string_view right, std::span<ServerFire const> moves)
-        : left{left}, right{right}, moves{moves.begin(), moves.end()} {}
+      template<RangeOf<ServerFire> R = std::initializer_list<ServerFire>>
+      constexpr Recording(std::string_view left, std::string_view right, R&& moves)
+        : left{left}, right{right}, moves{collect<ServerFire>(moves)} {}
 
       constexpr inline void push_back(const auto& move) { moves.push_back(move); }
 
       [[nodiscard]] constexpr inline auto data() const { return std::tie(left, right, moves); }
 
       // Emergency
-      static Recording from_bytes(std::span<std::byte const> bytes) {
-        uint64_t offset = 0;
-        return deserialize(bytes, offset);
-      }
+      static Recording from_bytes(std::span<std::byte const> bytes);
 
      private:
       std::string left;
@@ -518,9 +803,417 @@ namespace NM {
 
       friend Message;
         constexpr static inline BodyType getType() { return BodyType::RECORDING; }
-        std::vector<std::byte> serialize() const;
-        static Recording     deserialize(std::span<std::byte const> bytes, uint64_t& offset);
     };
+
+   private:
+    /**
+     * Calls f with std::type_identity of the class matching a body type.
+     * Throws MangledBytesError if there is no such class.
+     */
+    template<typename F>
+    static decltype(auto) visitBody(BodyType type, F&& f) {
+      switch (type) {
+        using enum BodyType;
+        case CREDENTIALS:       return f(std::type_identity<Credentials>{});
+        case RELATION_UPDATE:   return f(std::type_identity<Relationship>{});
+        case CHAT_LOG:          return f(std::type_identity<ChatLog>{});
+        case CHAT_UPDATE:       return f(std::type_identity<ChatUpdate>{});
+        case ACCOUNT:           return f(std::type_identity<Account>{});
+        case MATCHES:           return f(std::type_identity<Matches>{});
+        case HOST_MATCH:        return f(std::type_identity<HostLobby>{});
+        case JOIN_MATCH:        return f(std::type_identity<JoinLobby>{});
+        case CHANGE_SLOT:       return f(std::type_identity<SlotLobby>{});
+        case LOBBY_DETAILS:     return f(std::type_identity<LobbyParameters>{});
+        case FACTION:           return f(std::type_identity<Faction>{});
+        case BOAT_SELECTION:    return f(std::type_identity<BoatSelection>{});
+        case CONFIRMATION:      return f(std::type_identity<Confirmation>{});
+        case START_COMBAT:      return f(std::type_identity<StartCombat>{});
+        case ABILITY_SELECTION: return f(std::type_identity<AbilitySelection>{});
+        case CLIENT_FIRE:       return f(std::type_identity<ClientFire>{});
+        case SERVER_FIRE:       return f(std::type_identity<ServerFire>{});
+        case GAME_END:          return f(std::type_identity<GameEnd>{});
+        case RECORDING:         return f(std::type_identity<Recording>{});
+        case HELLO:             return f(std::type_identity<Hello>{});
+        case CLOCK_SYNC:        return f(std::type_identity<ClockSync>{});
+        case DEADLINE:          return f(std::type_identity<Deadline>{});
+        case NOTHING:
+        default:
+          throw MangledBytesError("Unknown body type");
+      }
+    }
+  };
+
+  //    ╔════════════════════╗
+  //    ║ Schema Definitions ║
+  //    ╚════════════════════╝
+
+  /*
+   * Compact encoding, one Codec per field type:
+   *  - encode() appends a field to a Writer, which also gives the exact
+   *    size when the Writer only counts.
+   *  - decode() reads a field back, bounds-checked, as the type that
+   *    constructors take: strings and lists come out as views into the
+   *    body, so nothing is allocated until the object copies them.
+   *  - skip() moves past a field without building anything.
+   *
+   * A body is the concatenation of the fields returned by its data(),
+   * in order. Adding a message type takes a data() and a constructor
+   * accepting the decoded fields in the same order, nothing else.
+   */
+
+  namespace wire {
+    // Coordinates under this fit in a nibble each, others are escaped
+    constexpr size_t PACKED_LIMIT = 0xF;
+    constexpr std::byte ESCAPE{0xFF};
+
+    /**
+     * Maps signed integers to unsigned ones so that small negative
+     * values also make short varints: 0, -1, 1, -2... become 0, 1, 2, 3...
+     */
+    constexpr inline uint64_t zigzag(int64_t value) {
+      return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    constexpr inline int64_t unzigzag(uint64_t value) {
+      return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    inline void put_byte(Writer& writer, std::byte value) {
+      writer.write(std::span{&value, 1});
+    }
+
+    inline void put_varint(Writer& writer, uint64_t value) {
+      std::array<std::byte, MAX_VARINT> buffer;
+      writer.write(std::span{buffer.data(), write_varint(value, buffer.data())});
+    }
+
+    inline std::byte to_byte(std::span<std::byte const> bytes, uint64_t& offset) {
+      if (offset >= bytes.size())
+        throw MangledBytesError("Out of range byte conversion");
+      return bytes[offset++];
+    }
+
+    inline uint64_t to_varint(std::span<std::byte const> bytes, uint64_t& offset) {
+      uint64_t value = 0;
+      size_t size = offset < bytes.size() ? read_varint(bytes.subspan(offset), value) : 0;
+      if (size == 0)
+        throw MangledBytesError("Out of range varint conversion");
+      offset += size;
+      return value;
+    }
+
+    /**
+     * Reads an element count, refusing counts that could not possibly
+     * fit in the rest of the body to avoid allocating for mangled input.
+     * Every element takes at least one byte.
+     */
+    inline uint64_t to_count(std::span<std::byte const> bytes, uint64_t& offset) {
+      uint64_t size = to_varint(bytes, offset);
+      if (size > bytes.size() - offset)
+        throw MangledBytesError("Out of range count conversion");
+      return size;
+    }
+
+    inline std::string_view to_string_view(std::span<std::byte const> bytes, uint64_t& offset) {
+      uint64_t size = to_varint(bytes, offset);
+      if (size > bytes.size() - offset)
+        throw MangledBytesError("Out of range string conversion");
+
+      std::string_view str{reinterpret_cast<const char*>(bytes.data()) + offset, size};
+      offset += size;
+      return str;
+    }
+
+    template<typename T>
+    struct is_tuple : std::false_type {};
+
+    template<typename... Ts>
+    struct is_tuple<std::tuple<Ts...>> : std::true_type {};
+
+    /**
+     * data() returns either a tuple of its fields or a single field.
+     */
+    template<typename T>
+    constexpr auto as_tuple(T&& fields) {
+      if constexpr (is_tuple<std::remove_cvref_t<T>>::value)
+        return std::forward<T>(fields);
+      else
+        return std::tuple<T>(std::forward<T>(fields));
+    }
+  }
+
+  // Single bytes as is, wider integers as varints, signed ones zigzagged
+  template<std::integral T>
+  struct Codec<T> {
+    static void encode(Writer& writer, T value) {
+      if constexpr (sizeof(T) == 1)
+        wire::put_byte(writer, static_cast<std::byte>(value));
+      else if constexpr (std::is_signed_v<T>)
+        wire::put_varint(writer, wire::zigzag(value));
+      else
+        wire::put_varint(writer, value);
+    }
+
+    static T decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      if constexpr (sizeof(T) == 1)
+        return static_cast<T>(wire::to_byte(bytes, offset));
+      else if constexpr (std::is_signed_v<T>)
+        return checked(wire::unzigzag(wire::to_varint(bytes, offset)));
+      else
+        return checked(wire::to_varint(bytes, offset));
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { decode(bytes, offset); }
+
+   private:
+    template<typename U>
+    static T checked(U value) {
+      if (!std::in_range<T>(value))
+        throw MangledBytesError("Out of range integral conversion");
+      return static_cast<T>(value);
+    }
+  };
+
+  /**
+   * Values an enum in a message body may take, first and last included.
+   * Every such enum has one: anything outside is refused when decoding,
+   * before it reaches a switch or indexes a table.
+   */
+  template<typename T>
+    requires std::is_enum_v<T>
+  struct EnumRange;
+
+  template<auto LAST, auto FIRST = decltype(LAST){}>
+  struct Enumerators {
+    static constexpr uint8_t first = static_cast<uint8_t>(FIRST);
+    static constexpr uint8_t last  = static_cast<uint8_t>(LAST);
+  };
+
+  // One before a sentinel ending the enumerators
+  template<auto SENTINEL>
+  struct Sentinel : Enumerators<static_cast<decltype(SENTINEL)>(static_cast<uint8_t>(SENTINEL) - 1)> {};
+
+  // Newer peers may offer later encodings, which acceptHello() brings down to ours
+  template<> struct EnumRange<Networkable::Encoding>        : Enumerators<static_cast<Networkable::Encoding>(UINT8_MAX), Networkable::Encoding::COMPACT> {};
+  template<> struct EnumRange<Message::Relationship::Kind>  : Enumerators<Message::Relationship::Kind::SENDINGGAME> {};
+  template<> struct EnumRange<Message::SlotLobby::Slot>     : Enumerators<Message::SlotLobby::Slot::QUITTING> {};
+  template<> struct EnumRange<Timer::Type>                  : Enumerators<Timer::Type::TURN> {};
+  template<> struct EnumRange<GameModel::GameMode>          : Enumerators<GameModel::GameMode::COMMANDERS> {};
+  template<> struct EnumRange<GameModel::Faction>           : Enumerators<GameModel::Faction::CAPTAIN> {};
+  template<> struct EnumRange<GameModel::Victor>            : Enumerators<GameModel::Victor::REPLAY> {};
+  template<> struct EnumRange<GameModel::CellType>          : Enumerators<GameModel::CellType::SUNK> {};
+  template<> struct EnumRange<Boat::Type>                   : Sentinel<Boat::Type::SENTINEL> {};
+  template<> struct EnumRange<Ability::Type>                : Sentinel<Ability::Type::A_SENTINEL> {};
+
+  // Enumerators all fit in a byte
+  template<typename T>
+    requires std::is_enum_v<T>
+  struct Codec<T> {
+    static void encode(Writer& writer, T value) {
+      wire::put_byte(writer, static_cast<std::byte>(value));
+    }
+
+    static T decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      auto value = static_cast<uint8_t>(wire::to_byte(bytes, offset));
+      if (value < EnumRange<T>::first || value > EnumRange<T>::last)
+        throw MangledBytesError("Out of range enum conversion");
+      return static_cast<T>(value);
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { decode(bytes, offset); }
+  };
+
+  template<typename Rep, typename Period>
+  struct Codec<chrono::duration<Rep, Period>> {
+    using Duration = chrono::duration<Rep, Period>;
+
+    static void encode(Writer& writer, Duration value) {
+      Codec<Rep>::encode(writer, value.count());
+    }
+
+    static Duration decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      return Duration(Codec<Rep>::decode(bytes, offset));
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { decode(bytes, offset); }
+  };
+
+  // Length then characters
+  template<>
+  struct Codec<std::string> {
+    static void encode(Writer& writer, std::string_view str) {
+      wire::put_varint(writer, str.size());
+      writer.write(std::as_bytes(std::span{str}));
+    }
+
+    static std::string_view decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      return wire::to_string_view(bytes, offset);
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { decode(bytes, offset); }
+  };
+
+  // Fixed-size names are sent without their trailing zeroes
+  template<size_t N>
+  struct Codec<std::array<char, N>> {
+    static void encode(Writer& writer, const std::array<char, N>& name) {
+      Codec<std::string>::encode(writer, {name.data(), strnlen(name.data(), N)});
+    }
+
+    static std::string_view decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      auto name = wire::to_string_view(bytes, offset);
+      if (name.size() >= N)  // The array keeps a NUL after it
+        throw MangledBytesError("Out of range name conversion");
+      return name;
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { decode(bytes, offset); }
+  };
+
+  // Count then strings
+  template<>
+  struct Codec<std::vector<std::string>> {
+    static void encode(Writer& writer, const std::vector<std::string>& vec) {
+      wire::put_varint(writer, vec.size());
+      for (std::string_view str : vec)
+        Codec<std::string>::encode(writer, str);
+    }
+
+    static StringList decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      uint64_t size  = wire::to_count(bytes, offset);
+      uint64_t start = offset;
+
+      for (uint64_t i = 0; i < size; ++i)
+        wire::to_string_view(bytes, offset);
+
+      return StringList(bytes.subspan(start, offset - start), size);
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { decode(bytes, offset); }
+  };
+
+  // Count then elements, every element is validated once here so that iterating does not need to
+  template<typename T>
+  struct Codec<std::vector<T>> {
+    static void encode(Writer& writer, const std::vector<T>& vec) {
+      wire::put_varint(writer, vec.size());
+      for (auto&& element : vec)
+        Codec<T>::encode(writer, element);
+    }
+
+    static PackedList<T> decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      uint64_t size  = wire::to_count(bytes, offset);
+      uint64_t start = offset;
+
+      for (uint64_t i = 0; i < size; ++i)
+        Codec<T>::skip(bytes, offset);
+
+      return PackedList<T>(bytes.subspan(start, offset - start), size);
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { decode(bytes, offset); }
+  };
+
+  // Both nibbles in one byte on the board, escaped varints off it
+  template<>
+  struct Codec<BoardCoordinates> {
+    static void encode(Writer& writer, BoardCoordinates coordinates) {
+      if (coordinates.x() < wire::PACKED_LIMIT && coordinates.y() < wire::PACKED_LIMIT) {
+        wire::put_byte(writer, static_cast<std::byte>(coordinates.x() << 4 | coordinates.y()));
+        return;
+      }
+      wire::put_byte(writer, wire::ESCAPE);
+      wire::put_varint(writer, coordinates.x());
+      wire::put_varint(writer, coordinates.y());
+    }
+
+    static BoardCoordinates decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      auto packed = static_cast<uint8_t>(wire::to_byte(bytes, offset));
+      if (packed != static_cast<uint8_t>(wire::ESCAPE))
+        return BoardCoordinates(packed >> 4, packed & 0xF);
+
+      auto x = Codec<size_t>::decode(bytes, offset);
+      auto y = Codec<size_t>::decode(bytes, offset);
+      return BoardCoordinates(x, y);
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { decode(bytes, offset); }
+  };
+
+  template<>
+  struct Codec<Message::ServerFire::Cell> {
+    using Cell = Message::ServerFire::Cell;
+
+    static void encode(Writer& writer, const Cell& cell) {
+      Codec<BoardCoordinates>::encode(writer, cell.c);
+      Codec<int>::encode(writer, cell.id);
+      Codec<Cell::State>::encode(writer, cell.new_state);
+    }
+
+    static Cell decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      auto c         = Codec<BoardCoordinates>::decode(bytes, offset);
+      auto id        = Codec<int>::decode(bytes, offset);
+      auto new_state = Codec<Cell::State>::decode(bytes, offset);
+      return Cell{c, id, new_state};
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { decode(bytes, offset); }
+  };
+
+  // Name, players, then both flags in one byte
+  template<>
+  struct Codec<Message::Matches::Match> {
+    using Match = Message::Matches::Match;
+
+    static void encode(Writer& writer, const Match& match) {
+      Codec<decltype(match.name)>::encode(writer, match.name);
+      Codec<uint8_t>::encode(writer, match.players);
+      Codec<uint8_t>::encode(writer, static_cast<uint8_t>(match.started | match.password << 1));
+    }
+
+    static Match decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      Match match{};
+      ranges::copy(Codec<decltype(match.name)>::decode(bytes, offset), match.name.data());
+      match.players  = Codec<uint8_t>::decode(bytes, offset);
+      auto flags     = Codec<uint8_t>::decode(bytes, offset);
+      match.started  = flags & 0b01;
+      match.password = flags & 0b10;
+      return match;
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { decode(bytes, offset); }
+  };
+
+  // Fields of data(), one after the other
+  template<Serializable T>
+  struct Codec<T> {
+    using Fields = decltype(wire::as_tuple(std::declval<const T&>().data()));
+
+    template<size_t I>
+    using Field = std::remove_cvref_t<std::tuple_element_t<I, Fields>>;
+
+    static void encode(Writer& writer, const T& body) {
+      std::apply([&](const auto&... field) {
+        (Codec<std::remove_cvref_t<decltype(field)>>::encode(writer, field), ...);
+      }, wire::as_tuple(body.data()));
+    }
+
+    /**
+     * Decodes every field in order, as views where possible.
+     *
+     * \return Tuple of the constructor arguments.
+     */
+    static auto fields(std::span<std::byte const> bytes, uint64_t& offset) {
+      return [&]<size_t... I>(std::index_sequence<I...>) {
+        // Braced initialization guarantees left to right evaluation
+        return std::tuple<decltype(Codec<Field<I>>::decode(bytes, offset))...>{Codec<Field<I>>::decode(bytes, offset)...};
+      }(std::make_index_sequence<std::tuple_size_v<Fields>>{});
+    }
+
+    static T decode(std::span<std::byte const> bytes, uint64_t& offset) {
+      return std::make_from_tuple<T>(fields(bytes, offset));
+    }
+
+    static void skip(std::span<std::byte const> bytes, uint64_t& offset) { fields(bytes, offset); }
   };
 }
-#endif
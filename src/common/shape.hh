@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+
+#include "bitboard.hh"
+#include "board_coordinates.hh"
+
+/**
+ * Cells of a shape placed somewhere, held inline: no shape is larger
+ * than a carrier, so placing one never allocates.
+ */
+class Footprint {
+ public:
+  static constexpr size_t MAX_CELLS = 5;
+
+  constexpr void push_back(BoardCoordinates c) { cells[count++] = c; }
+
+  [[nodiscard]] constexpr inline size_t size()  const { return count; }
+  [[nodiscard]] constexpr inline bool   empty() const { return count == 0; }
+
+  [[nodiscard]] constexpr inline BoardCoordinates operator[](size_t i) const { return cells[i]; }
+
+  [[nodiscard]] constexpr inline const BoardCoordinates* begin() const { return cells.data(); }
+  [[nodiscard]] constexpr inline const BoardCoordinates* end()   const { return cells.data() + count; }
+
+ private:
+  std::array<BoardCoordinates, MAX_CELLS> cells{};
+  size_t count = 0;
+};
+
+/**
+ * Cells of a ship or an area of effect, as offsets from its first cell.
+ * Everything about it is known at compile time, so are the tables built
+ * from it.
+ */
+class Shape {
+ public:
+  struct Offset {
+    int8_t dx, dy;
+  };
+
+  constexpr Shape() = default;
+  constexpr Shape(std::initializer_list<Offset> cells) {
+    for (Offset offset : cells)
+      offsets[count++] = offset;
+  }
+
+  [[nodiscard]] constexpr inline size_t size() const { return count; }
+  [[nodiscard]] constexpr inline std::span<Offset const> cells() const { return {offsets.data(), count}; }
+
+  /**
+   * \return The shape turned a quarter turn around its first cell, as
+   *         many times as asked.
+   */
+  [[nodiscard]] constexpr Shape rotated(size_t quarter_turns) const {
+    Shape turned = *this;
+    for (size_t turn = 0; turn < quarter_turns % 4; ++turn)
+      for (Offset& offset : turned.offsets)
+        offset = {offset.dy, static_cast<int8_t>(-offset.dx)};
+    return turned;
+  }
+
+  /**
+   * Cells off the board wrap around like BoardCoordinates do, so that
+   * they stay off the board.
+   *
+   * \return The cells of the shape with its first cell on origin.
+   */
+  [[nodiscard]] constexpr Footprint at(BoardCoordinates origin) const {
+    Footprint placed;
+    for (Offset offset : cells())
+      placed.push_back({origin.x() + static_cast<size_t>(offset.dx), origin.y() + static_cast<size_t>(offset.dy)});
+    return placed;
+  }
+
+  /**
+   * \return The cells of the shape from origin, empty unless all of them
+   *         are on the board.
+   */
+  [[nodiscard]] constexpr Bitboard mask(BoardCoordinates origin) const {
+    Bitboard inside = clipped(origin);
+    return inside.count() == count ? inside : Bitboard{};
+  }
+
+  /**
+   * \return The cells of the shape from origin that are on the board.
+   */
+  [[nodiscard]] constexpr Bitboard clipped(BoardCoordinates origin) const {
+    Bitboard inside;
+    for (BoardCoordinates c : at(origin))
+      inside |= Bitboard::cell(c);
+    return inside;
+  }
+
+ private:
+  std::array<Offset, Footprint::MAX_CELLS> offsets{};
+  size_t count = 0;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+/**
+ * Bounded queue between exactly one producer thread and one consumer
+ * thread, without any lock: each side only ever writes its own index,
+ * and reads the other's only when its cached copy says the ring is full
+ * or empty. Waking the other side is left to the caller.
+ */
+template<typename T, size_t CAPACITY>
+class SpscQueue {
+  static_assert(std::has_single_bit(CAPACITY), "Capacity must be a power of two");
+
+ public:
+  SpscQueue() = default;
+
+  /**
+   * Producer side only. The item is left untouched when there is no room,
+   * so that it can be pushed again later.
+   *
+   * \return Whether the item was queued.
+   */
+  [[nodiscard]] bool push(T&& item) {
+    size_t tail = back.load(std::memory_order_relaxed);
+    if (tail - front_seen == CAPACITY) {
+      front_seen = front.load(std::memory_order_acquire);
+      if (tail - front_seen == CAPACITY)
+        return false;
+    }
+    slots[tail & (CAPACITY - 1)] = std::move(item);
+    back.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side only.
+   *
+   * \return The oldest item, if any.
+   */
+  [[nodiscard]] std::optional<T> pop() {
+    size_t head = front.load(std::memory_order_relaxed);
+    if (head == back_seen) {
+      back_seen = back.load(std::memory_order_acquire);
+      if (head == back_seen)
+        return std::nullopt;
+    }
+    std::optional<T> item{std::move(slots[head & (CAPACITY - 1)])};
+    front.store(head + 1, std::memory_order_release);
+    return item;
+  }
+
+  SpscQueue(SpscQueue&&)      = delete;
+  SpscQueue(const SpscQueue&) = delete;
+
+ private:
+  std::array<T, CAPACITY> slots{};
+
+  // Each index on its own cache line, next to the copy of the other one
+  // kept by the same side
+  alignas(64) std::atomic<size_t> front = 0;  // Written by the consumer
+  size_t back_seen = 0;
+  alignas(64) std::atomic<size_t> back = 0;   // Written by the producer
+  size_t front_seen = 0;
+};
@@ -20,8 +20,21 @@ class Timer {
   static constexpr auto DEFAULTLIMIT = chrono::seconds(1800);
   static constexpr auto DEFAULTTURN  = chrono::seconds(60);
 
+  // Monotonic, unlike the wall clock that may jump while a match is played
+  using Clock = chrono::steady_clock;
+
+  /**
+   * Times on the wire count microseconds since the sender's Clock epoch.
+   */
+  [[nodiscard]] static inline chrono::microseconds toWire(Clock::time_point time) {
+    return chrono::duration_cast<chrono::microseconds>(time.time_since_epoch());
+  }
+
+  [[nodiscard]] static inline Clock::time_point fromWire(chrono::microseconds time) {
+    return Clock::time_point(chrono::duration_cast<Clock::duration>(time));
+  }
+
  protected:
-  using time_point = chrono::time_point<chrono::system_clock>;
 
   bool running;
   Type t;
@@ -3,11 +3,6 @@
 #include <charconv>
 #include <string_view>
 #include <optional>
-#include <thread>
-#include <mutex>
-#include <queue>
-#include <functional>
-#include <condition_variable>
 #include <iostream>
 
 namespace NM {
@@ -111,8 +106,8 @@ namespace NM {
     }
 
     friend std::ostream& operator<<(std::ostream& output, setc colorizer) {
-      output << apply_color(colorizer.fg, colorizer.bg);
-      return output;
+      // Written piece by piece, as it is done for every cell of a frame
+      return output << code << static_cast<unsigned>(colorizer.fg) << ';' << static_cast<unsigned>(colorizer.bg) + 10 << suffix;
     }
   };
 
@@ -135,63 +130,4 @@ namespace NM {
       return output;
     }
   };
-
-  /**
-   * Concept of a function that does not return anything.
-   */
-  template<typename F, typename... Args>
-  concept VoidReturn = std::is_invocable_v<F&&> && std::same_as<std::invoke_result_t<F&&, Args&&...>, void>;
-
-  /**
-   * std::jthread wrapper that sleeps while there are no tasks in internal queue.
-   */
-  class ReusableThread {
-   public:
-    /**
-     * Initializes a sleeping thread with an empty queue.
-     */
-    ReusableThread();
-
-    /**
-     * Delegates a new task to the underlying thread.
-     * Member functions must be called together with owning object.
-     * Tasks must return void.
-     *
-     * \param Function with void return type.
-     * \param Sequence of arguments for function.
-     */
-    template<typename F, typename... Args>
-      requires VoidReturn<F, Args...>
-    void push(F&& task, Args&&... args) {
-      {
-        std::scoped_lock lock(thread_mutex);
-        tasks.push(std::bind_front(task, args...));
-      }
-      condition.notify_all();
-    }
-
-    /**
-     * Acquire scoped_lock for when a critical task may be running.
-     * 
-     * \return std::scoped_lock of the internal thread_mutex.
-     */
-    [[nodiscard]] inline std::scoped_lock<std::mutex> scoped_lock() { return std::scoped_lock{thread_mutex}; }
-
-    ReusableThread(ReusableThread&&)      = delete;
-    ReusableThread(const ReusableThread&) = delete;
-
-   private:
-    std::queue<std::function<void()>> tasks;
-
-    std::condition_variable condition;
-    std::mutex thread_mutex;
-    std::jthread worker;
-
-    /**
-     * Internal function called by the thread on initialization.
-     * 
-     * \param The std::stop_token of a std::jthread.
-     */
-    void run(std::stop_token token);
-  };
 }
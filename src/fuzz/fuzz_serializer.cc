@@ -0,0 +1,82 @@
+#include <cstdlib>
+#include <vector>
+
+#include "../common/serializer.hh"
+
+/*
+ * libFuzzer target for everything decoding untrusted frames:
+ * Message::deserialize(), then extract() and extract_view() of whatever
+ * the header claims the body to be.
+ *
+ * Besides not crashing under the sanitizers, anything that decodes must
+ * re-encode into a frame that decodes back to the same bytes.
+ *
+ * Build with: make fuzz_serializer (needs clang)
+ * Run with:   ./fuzz_serializer -max_len=4096 corpus/
+ */
+
+using NM::Message;
+using Request  = Networkable::Request;
+
+template<typename... Ts>
+struct Bodies {};
+
+using AllBodies = Bodies<Message::Hello, Message::Credentials, Message::Relationship, Message::ChatLog,
+                         Message::ChatUpdate, Message::Account, Message::Matches, Message::HostLobby,
+                         Message::JoinLobby, Message::SlotLobby, Message::LobbyParameters, Message::Faction,
+                         Message::BoatSelection, Message::Confirmation, Message::StartCombat,
+                         Message::AbilitySelection, Message::ClientFire, Message::ServerFire,
+                         Message::GameEnd, Message::Recording, Message::ClockSync, Message::Deadline>;
+
+// Aborts so that libFuzzer saves the input
+static void check(bool condition) {
+  if (!condition)
+    std::abort();
+}
+
+// Touches every element so that lazily decoded lists are decoded too
+template<typename... Fields>
+static void walk(const std::tuple<Fields...>& fields) {
+  std::apply([](const auto&... field) {
+    ([&] {
+      if constexpr (ranges::input_range<decltype(field)>
+                    && !std::is_convertible_v<decltype(field), std::string_view>)
+        for (auto&& element : field)
+          (void)element;
+    }(), ...);
+  }, fields);
+}
+
+template<typename T>
+static void roundTrip(const Message& message) {
+  auto content = message.extract<T>();
+  if (!content)
+    return;
+
+  if constexpr (requires { typename T::View; }) {
+    auto view = message.extract_view<T>();
+    check(view.has_value());
+  }
+
+  uint64_t offset = 0;
+  walk(NM::Codec<T>::fields(message.get_body(), offset));
+
+  // A valid body may have a non canonical encoding, but re-encoding is stable
+  auto frame = Message::serialize(Message(message.request(), *content));
+  auto again = Message::deserialize(std::vector<std::byte>(frame)).extract<T>();
+  check(again.has_value());
+  check(Message::serialize(Message(message.request(), *again)) == frame);
+}
+
+template<typename... Ts>
+static void roundTrips(const Message& message, Bodies<Ts...>) {
+  (roundTrip<Ts>(message), ...);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  auto bytes = std::as_bytes(std::span{data, size});
+  Message message = Message::deserialize(std::vector<std::byte>(bytes.begin(), bytes.end()));
+  if (!message.empty())
+    roundTrips(message, AllBodies{});
+  return 0;
+}
@@ -0,0 +1,475 @@
+#include "account_store.hh"
+
+#include <cerrno>
+#include <crypt.h>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "../common/network_io.hh"
+
+using std::byte, std::span, std::string_view, std::vector;
+
+namespace {
+  constexpr string_view SNAPSHOT_MAGIC = "BSAS";
+  constexpr string_view LOG_MAGIC      = "BSAL";
+  constexpr uint32_t    VERSION        = 2;
+  constexpr size_t      HEADER_SIZE    = 4 + sizeof(uint32_t) + sizeof(uint64_t);  // Magic, version, generation
+
+  enum Operation : uint8_t {
+    CREATE = 1,
+    ADD,
+    REMOVE
+  };
+
+  template<typename T>
+  void put(vector<byte>& out, T value) {
+    out.resize(out.size() + sizeof(T));
+    NM::write_le(value, out.data() + out.size() - sizeof(T));
+  }
+
+  void put(vector<byte>& out, string_view text) {
+    auto bytes = std::as_bytes(span{text});
+    out.insert(out.end(), bytes.begin(), bytes.end());
+  }
+
+  void putText(vector<byte>& out, string_view text) {
+    put(out, static_cast<uint32_t>(text.size()));
+    put(out, text);
+  }
+
+  template<typename T>
+  T get(span<byte const> bytes, uint64_t& offset) {
+    if (offset > bytes.size() || bytes.size() - offset < sizeof(T))
+      throw std::runtime_error("Account store cut short");
+    offset += sizeof(T);
+    return NM::read_le<T>(bytes.data() + offset - sizeof(T));
+  }
+
+  span<byte const> get(span<byte const> bytes, uint64_t& offset, uint64_t size) {
+    if (offset > bytes.size() || bytes.size() - offset < size)
+      throw std::runtime_error("Account store cut short");
+    offset += size;
+    return bytes.subspan(offset - size, size);
+  }
+
+  string_view getText(span<byte const> bytes, uint64_t& offset) {
+    span<byte const> text = get(bytes, offset, get<uint32_t>(bytes, offset));
+    return {reinterpret_cast<const char*>(text.data()), text.size()};
+  }
+
+  // Magic, version and generation, which is returned
+  uint64_t getHeader(span<byte const> bytes, string_view magic) {
+    uint64_t offset = 0;
+    span<byte const> found = get(bytes, offset, magic.size());
+    if (!std::equal(found.begin(), found.end(), std::as_bytes(span{magic}).begin()) || get<uint32_t>(bytes, offset) != VERSION)
+      throw std::runtime_error("Not an account store of this version");
+    return get<uint64_t>(bytes, offset);
+  }
+
+  vector<byte> header(string_view magic, uint64_t generation) {
+    vector<byte> out;
+    put(out, magic);
+    put(out, VERSION);
+    put(out, generation);
+    return out;
+  }
+
+  // Compares every byte whatever the first difference, as not to tell where it is
+  bool sameBytes(string_view left, string_view right) {
+    if (left.size() != right.size())
+      return false;
+    unsigned char difference = 0;
+    for (size_t i = 0; i < left.size(); ++i)
+      difference |= static_cast<unsigned char>(left[i] ^ right[i]);
+    return difference == 0;
+  }
+
+  // FNV-1a
+  uint64_t hash(string_view text) {
+    uint64_t digest = 0xcbf29ce484222325;
+    for (char c : text)
+      digest = (digest ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    return digest;
+  }
+
+  // Finalizer of splitmix64, as consecutive account numbers would cluster
+  uint64_t mix(uint64_t key) {
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+    return key ^ (key >> 31);
+  }
+
+  uint64_t pair(AccountStore::Id id, AccountStore::Id other) {
+    return uint64_t{id} << 32 | other;
+  }
+
+  bool writeAll(int fd, span<byte const> bytes) {
+    while (!bytes.empty()) {
+      ssize_t written = write(fd, bytes.data(), bytes.size());
+      if (written == -1) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      bytes = bytes.subspan(static_cast<size_t>(written));
+    }
+    return true;
+  }
+
+  // A whole file, read-only, empty if missing
+  class Mapping {
+   public:
+    explicit Mapping(const std::string& path) {
+      int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd == -1) {
+        if (errno != ENOENT)
+          throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+        return;
+      }
+      struct stat status;
+      if (fstat(fd, &status) == 0 && status.st_size > 0) {
+        void* mapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED)
+          bytes = {static_cast<const byte*>(mapped), static_cast<size_t>(status.st_size)};
+      }
+      close(fd);
+    }
+
+    ~Mapping() {
+      if (!bytes.empty())
+        munmap(const_cast<byte*>(bytes.data()), bytes.size());
+    }
+
+    Mapping(Mapping&&)      = delete;
+    Mapping(const Mapping&) = delete;
+
+    span<byte const> bytes;
+  };
+}
+
+//                   ╔═════════╗
+//                   ║ Lookups ║
+//                   ╚═════════╝
+
+AccountStore::AccountStore(std::string path) : path{std::move(path)}, names(64, NONE), relations(64) {
+  load();
+}
+
+AccountStore::~AccountStore() {
+  commit();
+  if (log_fd != -1)
+    close(log_fd);
+}
+
+size_t AccountStore::slot(string_view name) const {
+  size_t mask = names.size() - 1;
+  size_t at   = hash(name) & mask;
+  while (names[at] != NONE && accounts[names[at]].name != name)
+    at = (at + 1) & mask;
+  return at;
+}
+
+size_t AccountStore::slot(uint64_t key) const {
+  size_t mask = relations.size() - 1;
+  size_t at   = mix(key) & mask;
+  while (relations[at].key != EMPTY && relations[at].key != key)
+    at = (at + 1) & mask;
+  return at;
+}
+
+void AccountStore::rehashNames(size_t capacity) {
+  names.assign(capacity, NONE);
+  for (Id id = 0; id < accounts.size(); ++id)
+    names[slot(accounts[id].name)] = id;
+}
+
+void AccountStore::rehashRelations(size_t capacity) {
+  vector<Relation> previous = std::exchange(relations, vector<Relation>(capacity));
+  related = 0;
+  for (Relation& relation : previous)
+    if (relation.in != 0) {
+      relations[slot(relation.key)] = relation;
+      ++related;
+    }
+}
+
+std::optional<AccountStore::Id> AccountStore::find(string_view name) const {
+  Id id = names[slot(name)];
+  return id == NONE ? std::nullopt : std::optional{id};
+}
+
+bool AccountStore::has(Id id, List which, Id other) const {
+  const Relation& relation = relations[slot(pair(id, other))];
+  return relation.key != EMPTY && relation.in & 1 << static_cast<size_t>(which);
+}
+
+//                   ╔═════════╗
+//                   ║ Changes ║
+//                   ╚═════════╝
+
+AccountStore::Id AccountStore::insert(string_view name, string_view hashed) {
+  Id id = static_cast<Id>(accounts.size());
+  accounts.push_back({std::string{name}, std::string{hashed}, {}});
+  if (accounts.size() * 2 > names.size())
+    rehashNames(names.size() * 2);
+  else
+    names[slot(name)] = id;
+  return id;
+}
+
+bool AccountStore::link(Id id, List which, Id other) {
+  size_t list = static_cast<size_t>(which);
+  size_t at   = slot(pair(id, other));
+  if (relations[at].key == EMPTY) {
+    if ((related + 1) * 2 > relations.size()) {
+      rehashRelations(relations.size() * 2);
+      at = slot(pair(id, other));
+    }
+    relations[at].key = pair(id, other);
+    ++related;
+  }
+
+  Relation& relation = relations[at];
+  if (relation.in & 1 << list)
+    return false;
+  std::vector<Id>& members = accounts[id].lists[list];
+  relation.in |= static_cast<uint8_t>(1 << list);
+  relation.at[list] = static_cast<uint32_t>(members.size());
+  members.push_back(other);
+  return true;
+}
+
+bool AccountStore::unlink(Id id, List which, Id other) {
+  size_t list = static_cast<size_t>(which);
+  Relation& relation = relations[slot(pair(id, other))];
+  if (relation.key == EMPTY || !(relation.in & 1 << list))
+    return false;
+
+  // The last one takes its place
+  std::vector<Id>& members = accounts[id].lists[list];
+  uint32_t at = relation.at[list];
+  Id last     = members.back();
+  members[at] = last;
+  members.pop_back();
+  relations[slot(pair(id, last))].at[list] = at;
+  relation.in &= static_cast<uint8_t>(~(1 << list));
+  return true;
+}
+
+std::optional<std::string> AccountStore::hashPassword(string_view password) {
+  // Yescrypt, the salt kept in the hash along with the algorithm and its cost
+  std::array<char, CRYPT_GENSALT_OUTPUT_SIZE> salt;
+  auto data = std::make_unique<crypt_data>();
+  if (!crypt_gensalt_rn("$y$", 0, nullptr, 0, salt.data(), salt.size()))
+    return std::nullopt;
+  const char* hashed = crypt_r(std::string{password}.c_str(), salt.data(), data.get());
+  if (!hashed || hashed[0] == '*')
+    return std::nullopt;
+  return hashed;
+}
+
+bool AccountStore::checkPassword(string_view hashed, string_view password) {
+  auto data = std::make_unique<crypt_data>();
+  const char* attempt = crypt_r(std::string{password}.c_str(), std::string{hashed}.c_str(), data.get());
+  return attempt && attempt[0] != '*' && sameBytes(attempt, hashed);
+}
+
+std::optional<AccountStore::Id> AccountStore::create(string_view name, string_view hashed) {
+  if (find(name))
+    return std::nullopt;
+
+  vector<byte> body;
+  putText(body, name);
+  putText(body, hashed);
+  log(CREATE, body);
+  return insert(name, hashed);
+}
+
+bool AccountStore::add(Id id, List which, Id other) {
+  if (id >= accounts.size() || other >= accounts.size() || !link(id, which, other))
+    return false;
+
+  vector<byte> body;
+  put(body, static_cast<uint8_t>(which));
+  put(body, id);
+  put(body, other);
+  log(ADD, body);
+  return true;
+}
+
+bool AccountStore::remove(Id id, List which, Id other) {
+  if (id >= accounts.size() || other >= accounts.size() || !unlink(id, which, other))
+    return false;
+
+  vector<byte> body;
+  put(body, static_cast<uint8_t>(which));
+  put(body, id);
+  put(body, other);
+  log(REMOVE, body);
+  return true;
+}
+
+//                   ╔═════════╗
+//                   ║ On Disk ║
+//                   ╚═════════╝
+
+void AccountStore::log(uint8_t operation, span<byte const> body) {
+  put(pending, static_cast<uint32_t>(sizeof(operation) + body.size()));
+  put(pending, operation);
+  pending.insert(pending.end(), body.begin(), body.end());
+  ++logged;
+}
+
+void AccountStore::commit() {
+  if (pending.empty())
+    return;
+  // Kept for the next commit if it fails, the changes are live already
+  if (log_fd == -1 || !writeAll(log_fd, pending) || fdatasync(log_fd) == -1) {
+    std::cerr << "Could not log account changes: " << std::strerror(errno) << '\n';
+    return;
+  }
+  pending.clear();
+
+  if (logged >= SNAPSHOT_EVERY)
+    snapshot();
+}
+
+void AccountStore::load() {
+  {
+    Mapping snapshot(path + ".snapshot");
+    if (!snapshot.bytes.empty()) {
+      span<byte const> bytes = snapshot.bytes;
+      generation      = getHeader(bytes, SNAPSHOT_MAGIC);
+      uint64_t offset = HEADER_SIZE;
+      uint32_t count  = get<uint32_t>(bytes, offset);
+
+      for (uint32_t i = 0; i < count; ++i) {
+        string_view name = getText(bytes, offset);
+        insert(name, getText(bytes, offset));
+      }
+      // Only once they all exist, as lists refer to later accounts too
+      for (Id id = 0; id < count; ++id)
+        for (size_t list = 0; list < LISTS; ++list)
+          for (uint32_t members = get<uint32_t>(bytes, offset); members > 0; --members)
+            if (Id other = get<Id>(bytes, offset); other >= count || !link(id, static_cast<List>(list), other))
+              throw std::runtime_error("Account store snapshot is corrupted");
+    }
+  }
+
+  Mapping log(path + ".log");
+  uint64_t log_generation;
+  try {
+    log_generation = getHeader(log.bytes, LOG_MAGIC);
+  } catch (const std::runtime_error&) {
+    openLog(true);  // Missing, or cut short while it was being replaced
+    return;
+  }
+
+  if (log_generation != generation) {
+    openLog(true);
+    return;
+  }
+  openLog(false, replay(log.bytes));
+}
+
+size_t AccountStore::replay(span<byte const> bytes) {
+  uint64_t offset = HEADER_SIZE;
+  while (offset < bytes.size()) {
+    uint64_t start = offset;
+    try {
+      span<byte const> record = get(bytes, offset, get<uint32_t>(bytes, offset));
+      uint64_t at       = 0;
+      uint8_t operation = get<uint8_t>(record, at);
+      switch (operation) {
+        case CREATE: {
+          string_view name   = getText(record, at);
+          string_view hashed = getText(record, at);
+          if (!find(name))
+            insert(name, hashed);
+          break;
+        }
+        case ADD:
+        case REMOVE: {
+          auto list  = get<uint8_t>(record, at);
+          Id id      = get<Id>(record, at);
+          Id other   = get<Id>(record, at);
+          if (list >= LISTS || id >= accounts.size() || other >= accounts.size())
+            throw std::runtime_error("Account store log is corrupted");
+          if (operation == ADD)
+            link(id, static_cast<List>(list), other);
+          else
+            unlink(id, static_cast<List>(list), other);
+          break;
+        }
+        default:
+          throw std::runtime_error("Account store log is corrupted");
+      }
+    } catch (const std::runtime_error& error) {
+      std::cerr << error.what() << ", dropping its last " << bytes.size() - start << " bytes\n";
+      return start;
+    }
+    ++logged;
+  }
+  return offset;
+}
+
+void AccountStore::openLog(bool fresh, uint64_t size) {
+  if (log_fd == -1 && (log_fd = open((path + ".log").c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600)) == -1)
+    throw std::runtime_error("Could not open " + path + ".log: " + std::strerror(errno));
+
+  // Appending after the last whole record, or after a new header
+  vector<byte> start = header(LOG_MAGIC, generation);
+  if (ftruncate(log_fd, fresh ? 0 : static_cast<off_t>(size)) == -1 || lseek(log_fd, 0, SEEK_END) == -1
+      || (fresh && (!writeAll(log_fd, start) || fdatasync(log_fd) == -1)))
+    throw std::runtime_error("Could not write " + path + ".log: " + std::strerror(errno));
+  if (fresh)
+    logged = 0;
+}
+
+void AccountStore::snapshot() {
+  vector<byte> out = header(SNAPSHOT_MAGIC, generation + 1);
+  put(out, static_cast<uint32_t>(accounts.size()));
+  for (const Account& account : accounts) {
+    putText(out, account.name);
+    putText(out, account.password);
+  }
+  for (const Account& account : accounts)
+    for (const vector<Id>& members : account.lists) {
+      put(out, static_cast<uint32_t>(members.size()));
+      for (Id other : members)
+        put(out, other);
+    }
+
+  // Written aside then renamed over, so that a crash leaves either one whole
+  std::string name = path + ".snapshot";
+  int fd = open((name + ".tmp").c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  bool written = fd != -1 && writeAll(fd, out) && fsync(fd) == 0;
+  if (fd != -1)
+    close(fd);
+  if (!written || std::rename((name + ".tmp").c_str(), name.c_str()) == -1) {
+    std::cerr << "Could not write " << name << ": " << std::strerror(errno) << '\n';
+    return;  // The log goes on growing until the next try
+  }
+
+  std::filesystem::path directory = std::filesystem::path(path).parent_path();
+  if (int dir = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); dir != -1) {
+    fsync(dir);
+    close(dir);
+  }
+
+  // Until the log is restarted, its older generation tells it is part of the snapshot
+  ++generation;
+  try {
+    openLog(true);
+  } catch (const std::runtime_error& error) {
+    std::cerr << error.what() << '\n';
+  }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Accounts and the relations between them, in memory and on disk.
+ *
+ * Accounts are numbered in order of creation and found by name through
+ * an open-addressing index. Each keeps its four lists as account numbers,
+ * and every pair of accounts where one is in a list of the other has an
+ * entry in a second index, telling in O(1) whether it is and where: both
+ * checking and removing cost the same however many friends they have.
+ *
+ * On disk, PATH.snapshot holds every account as of some generation and
+ * PATH.log the changes made since, appended as they are committed. Once
+ * the log reached SNAPSHOT_EVERY changes, a snapshot of the next
+ * generation replaces both, so loading reads one snapshot and a bounded
+ * log however long the server ran. Integers are little-endian.
+ *
+ *   snapshot  "BSAS", u32 version, u64 generation, u32 accounts, then the
+ *             name and password hash of each, as a u32 length and its bytes,
+ *             then the four lists of each, as a u32 count and accounts
+ *   log       "BSAL", u32 version, u64 generation, then records of a u32
+ *             size and that many bytes, a u8 operation followed by
+ *               CREATE       name and password hash, as in the snapshot
+ *               ADD, REMOVE  u8 list, u32 account, u32 account in it
+ *
+ * A log of another generation than the snapshot was already part of it,
+ * and a record cut short by a crash is dropped. Passwords are never
+ * written: hashes are yescrypt in crypt(5) format, each with its own salt.
+ */
+class AccountStore {
+ public:
+  using Id = uint32_t;
+
+  // In the order of Message::Account
+  enum class List : uint8_t {
+    FRIENDS,
+    INBOUND,        // Friend requests received
+    OUTBOUND,       // Friend requests sent
+    GAME_REQUESTS,  // Hosts who invited this account to their lobby
+    L_SENTINEL
+  };
+
+  static constexpr size_t SNAPSHOT_EVERY = 1 << 14;  // Changes logged before the next snapshot
+  static constexpr size_t MAX_NAME       = 32;       // Bytes of a username at most
+
+  /**
+   * Loads the store, creating its files if missing. Throws
+   * std::runtime_error if they cannot be opened or are not a store.
+   *
+   * \param Path of the files, without their extension.
+   */
+  explicit AccountStore(std::string path);
+  ~AccountStore();
+
+  /**
+   * \return Account of that name, if there is one.
+   */
+  [[nodiscard]] std::optional<Id> find(std::string_view name) const;
+
+  /**
+   * \param Hash of its password, from hashPassword().
+   * \return New account, none if the name is taken.
+   */
+  std::optional<Id> create(std::string_view name, std::string_view hashed);
+
+  [[nodiscard]] inline const std::string& name(Id id) const { return accounts.at(id).name; }
+  [[nodiscard]] inline size_t             size()      const { return accounts.size(); }
+
+  [[nodiscard]] inline const std::string& passwordHash(Id id) const { return accounts.at(id).password; }
+
+  /**
+   * Hashes a password under a new random salt. Slow on purpose, and
+   * safe to call from any thread, as is checkPassword().
+   *
+   * \return Hash to give to create(), none if hashing failed.
+   */
+  [[nodiscard]] static std::optional<std::string> hashPassword(std::string_view password);
+
+  /**
+   * Hashes the attempt with the salt of the hash, then compares both
+   * in constant time.
+   *
+   * \param Hash of an account, from passwordHash().
+   */
+  [[nodiscard]] static bool checkPassword(std::string_view hashed, std::string_view password);
+
+  /**
+   * \return Accounts in a list of this one, in no particular order.
+   */
+  [[nodiscard]] inline std::span<Id const> list(Id id, List which) const {
+    return accounts.at(id).lists.at(static_cast<size_t>(which));
+  }
+
+  [[nodiscard]] bool has(Id id, List which, Id other) const;
+
+  /**
+   * \return Whether the list changed.
+   */
+  bool add(Id id, List which, Id other);
+  bool remove(Id id, List which, Id other);
+
+  /**
+   * Appends the changes made since the last commit to the log and syncs
+   * it, so that a batch of requests costs one write and one fdatasync.
+   * Takes a snapshot once the log is long enough.
+   */
+  void commit();
+
+  AccountStore(AccountStore&&)      = delete;
+  AccountStore(const AccountStore&) = delete;
+
+ private:
+  static constexpr size_t   LISTS = static_cast<size_t>(List::L_SENTINEL);
+  static constexpr Id       NONE  = UINT32_MAX;
+  static constexpr uint64_t EMPTY = UINT64_MAX;
+
+  struct Account {
+    std::string name;
+    std::string password;  // Hashed, in crypt(5) format
+    std::array<std::vector<Id>, LISTS> lists;
+  };
+
+  // An account and another one in some of its lists
+  struct Relation {
+    uint64_t key = EMPTY;                  // Account << 32 | other
+    uint8_t  in  = 0;                      // A bit per list holding the other
+    std::array<uint32_t, LISTS> at{};      // Where, in each of them
+  };
+
+  std::string path;
+  int log_fd = -1;
+  uint64_t generation = 0;
+  size_t logged = 0;               // Changes in the log
+  std::vector<std::byte> pending;  // Records not yet written
+
+  std::vector<Account> accounts;
+  std::vector<Id> names;             // Slots by name, NONE if empty
+  std::vector<Relation> relations;   // Slots by pair, emptied ones dropped when it grows
+  size_t related = 0;                // Slots in use
+
+  [[nodiscard]] size_t slot(std::string_view name) const;
+  [[nodiscard]] size_t slot(uint64_t key) const;
+  void rehashNames(size_t capacity);
+  void rehashRelations(size_t capacity);
+
+  // Changes made without logging them, as when loading
+  Id insert(std::string_view name, std::string_view hashed);
+  bool link(Id id, List which, Id other);
+  bool unlink(Id id, List which, Id other);
+
+  void log(uint8_t operation, std::span<std::byte const> body);
+  void load();
+  [[nodiscard]] size_t replay(std::span<std::byte const> bytes);
+  void openLog(bool fresh, uint64_t size = 0);
+  void snapshot();
+};
@@ -0,0 +1,208 @@
+#include "chat_store.hh"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "../common/network_io.hh"
+
+using std::byte, std::span, std::string, std::string_view, std::vector;
+
+namespace {
+  constexpr size_t LENGTH_SIZE = sizeof(uint32_t);
+  constexpr size_t OFFSET_SIZE = sizeof(uint64_t);
+
+  bool readAt(int fd, span<byte> out, uint64_t offset) {
+    while (!out.empty()) {
+      ssize_t got = pread(fd, out.data(), out.size(), static_cast<off_t>(offset));
+      if (got <= 0) {
+        if (got == -1 && errno == EINTR)
+          continue;
+        return false;
+      }
+      out = out.subspan(static_cast<size_t>(got));
+      offset += static_cast<uint64_t>(got);
+    }
+    return true;
+  }
+
+  bool writeAll(int fd, span<byte const> bytes) {
+    while (!bytes.empty()) {
+      ssize_t put = write(fd, bytes.data(), bytes.size());
+      if (put == -1) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      bytes = bytes.subspan(static_cast<size_t>(put));
+    }
+    return true;
+  }
+
+  template<typename T>
+  T get(span<byte const> bytes, size_t offset) {
+    return NM::read_le<T>(bytes.data() + offset);
+  }
+
+  uint64_t fileSize(int fd) {
+    struct stat status {};
+    return fstat(fd, &status) == 0 ? static_cast<uint64_t>(status.st_size) : 0;
+  }
+}
+
+ChatStore::ChatStore(string directory) : directory{std::move(directory)} {
+  std::error_code error;
+  std::filesystem::create_directories(this->directory, error);
+  if (error)
+    throw std::runtime_error("Could not create " + this->directory + ": " + error.message());
+}
+
+ChatStore::~ChatStore() {
+  for (auto& [key, chat] : open)
+    close(chat);
+}
+
+void ChatStore::close(Conversation& chat) {
+  if (chat.log_fd != -1) ::close(chat.log_fd);
+  if (chat.idx_fd != -1) ::close(chat.idx_fd);
+  chat.log_fd = chat.idx_fd = -1;
+}
+
+ChatStore::Conversation* ChatStore::conversation(Id one, Id other, bool create) {
+  auto [low, high] = std::minmax(one, other);
+  uint64_t key = uint64_t{low} << 32 | high;
+  if (auto it = open.find(key); it != open.end())
+    return &it->second;
+
+  string name = directory + "/" + std::to_string(low) + "-" + std::to_string(high);
+  int flags = O_RDWR | O_APPEND | O_CLOEXEC | (create ? O_CREAT : 0);
+  Conversation chat;
+  if ((chat.log_fd = ::open((name + ".log").c_str(), flags, 0600)) == -1
+      || (chat.idx_fd = ::open((name + ".idx").c_str(), flags, 0600)) == -1) {
+    if (create || errno != ENOENT)
+      std::cerr << "Could not open " << name << ": " << std::strerror(errno) << '\n';
+    close(chat);
+    return nullptr;
+  }
+  recover(chat);
+
+  if (open.size() >= MAX_OPEN) {
+    close(open.begin()->second);
+    open.erase(open.begin());
+  }
+  return &open.emplace(key, chat).first->second;
+}
+
+void ChatStore::recover(Conversation& chat) {
+  uint64_t log_size = fileSize(chat.log_fd);
+  chat.lines = fileSize(chat.idx_fd) / OFFSET_SIZE;
+  chat.size  = 0;
+
+  // The last line whose record is whole ends the log
+  while (chat.lines > 0) {
+    std::array<byte, OFFSET_SIZE> offset;
+    std::array<byte, LENGTH_SIZE> length;
+    if (readAt(chat.idx_fd, offset, (chat.lines - 1) * OFFSET_SIZE)) {
+      uint64_t at = get<uint64_t>(offset, 0);
+      if (at <= log_size && log_size - at >= LENGTH_SIZE && readAt(chat.log_fd, length, at)
+          && log_size - at - LENGTH_SIZE >= get<uint32_t>(length, 0)) {
+        chat.size = at + LENGTH_SIZE + get<uint32_t>(length, 0);
+        break;
+      }
+    }
+    --chat.lines;
+  }
+
+  if (chat.size != log_size && ftruncate(chat.log_fd, static_cast<off_t>(chat.size)) == -1)
+    std::cerr << "Could not repair a chat log: " << std::strerror(errno) << '\n';
+  if (chat.lines * OFFSET_SIZE != fileSize(chat.idx_fd) && ftruncate(chat.idx_fd, static_cast<off_t>(chat.lines * OFFSET_SIZE)) == -1)
+    std::cerr << "Could not repair a chat index: " << std::strerror(errno) << '\n';
+}
+
+bool ChatStore::append(Id one, Id other, string_view line) {
+  Conversation* chat = conversation(one, other, true);
+  if (!chat || line.size() > MAX_LINE)
+    return false;
+
+  std::array<byte, LENGTH_SIZE> length;
+  std::array<byte, OFFSET_SIZE> offset;
+  NM::write_le(static_cast<uint32_t>(line.size()), length.data());
+  NM::write_le(chat->size, offset.data());
+  std::array<iovec, 2> record{{
+    {length.data(), length.size()},
+    {const_cast<char*>(line.data()), line.size()},
+  }};
+
+  // Whole or nothing: a short write is cut off by recover()
+  ssize_t expected = static_cast<ssize_t>(LENGTH_SIZE + line.size());
+  if (writev(chat->log_fd, record.data(), record.size()) != expected || !writeAll(chat->idx_fd, offset)) {
+    std::cerr << "Could not append to a chat: " << std::strerror(errno) << '\n';
+    recover(*chat);
+    return false;
+  }
+  chat->size += LENGTH_SIZE + line.size();
+  ++chat->lines;
+  return true;
+}
+
+ChatStore::Page ChatStore::page(Id one, Id other, uint64_t before) {
+  Page page;
+  Conversation* chat = conversation(one, other, false);
+  if (!chat)
+    return page;
+
+  before = before == 0 ? chat->lines : std::min(before, chat->lines);
+  page.first = before - std::min<uint64_t>(before, PAGE);
+  if (page.first == before)
+    return page;
+
+  // Offsets of the page's lines, and of the line after it to know where the last ends
+  vector<byte> index((before - page.first) * OFFSET_SIZE);
+  if (!readAt(chat->idx_fd, index, page.first * OFFSET_SIZE))
+    return {before, {}};
+  auto offset = [&](uint64_t line) { return get<uint64_t>(index, (line - page.first) * OFFSET_SIZE); };
+
+  uint64_t end = chat->size;
+  if (before < chat->lines) {
+    std::array<byte, OFFSET_SIZE> next;
+    if (!readAt(chat->idx_fd, next, before * OFFSET_SIZE))
+      return {before, {}};
+    end = get<uint64_t>(next, 0);
+  }
+
+  // Trusted no further than the log: a mangled index reads as an empty page
+  for (uint64_t line = page.first; line < before; ++line)
+    if (offset(line) > (line + 1 < before ? offset(line + 1) : end))
+      return {before, {}};
+  if (end > chat->size)
+    return {before, {}};
+
+  // Oldest lines dropped first when the page is too large
+  uint64_t skipped = page.first;
+  while (skipped + 1 < before && end - offset(skipped) > PAGE_BYTES)
+    ++skipped;
+
+  vector<byte> bytes(end - offset(skipped));
+  if (!readAt(chat->log_fd, bytes, offset(skipped)))
+    return {before, {}};
+
+  page.lines.reserve(before - skipped);
+  for (size_t at = 0; at + LENGTH_SIZE <= bytes.size();) {
+    size_t length = get<uint32_t>(bytes, at);
+    at += LENGTH_SIZE;
+    if (bytes.size() - at < length)
+      break;
+    page.lines.emplace_back(reinterpret_cast<const char*>(bytes.data() + at), length);
+    at += length;
+  }
+  page.first = skipped;
+  return page;
+}
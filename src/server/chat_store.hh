@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "account_store.hh"
+
+/**
+ * Chats between accounts, on disk, read a page at a time.
+ *
+ * Each conversation is a pair of append-only files in the directory,
+ * named after both accounts, the lower first:
+ *
+ *   A-B.log  every line, as a u32 length and its bytes
+ *   A-B.idx  the offset in the log of every line, as a u64
+ *
+ * Line n's offset is at 8n in the index and the number of lines is its
+ * size over 8, so reading the last page, or the page before any line,
+ * costs two preads however long the conversation is. A line is written
+ * to the log before the index: lines cut short by a crash, or missing
+ * from the index, are dropped when the conversation is next opened.
+ * Integers are little-endian.
+ */
+class ChatStore {
+ public:
+  using Id = AccountStore::Id;
+
+  static constexpr size_t PAGE       = 50;        // Lines per page at most
+  static constexpr size_t PAGE_BYTES = 32 << 10;  // Bytes per page at most
+  static constexpr size_t MAX_LINE   = PAGE_BYTES - sizeof(uint32_t);  // Bytes per line at most, its length included
+  static constexpr size_t MAX_OPEN   = 64;        // Conversations kept open
+
+  struct Page {
+    uint64_t first = 0;  // Number of the first line
+    std::vector<std::string> lines;
+  };
+
+  /**
+   * Creates the directory if missing. Throws std::runtime_error if it
+   * cannot be.
+   */
+  explicit ChatStore(std::string directory);
+  ~ChatStore();
+
+  /**
+   * Appends a line to the conversation of both accounts, in either order.
+   *
+   * \return Whether it was written, never if longer than MAX_LINE.
+   */
+  bool append(Id one, Id other, std::string_view line);
+
+  /**
+   * \param Line before which to read, 0 for the latest lines.
+   * \return Lines right before it, the newest last.
+   */
+  [[nodiscard]] Page page(Id one, Id other, uint64_t before);
+
+  ChatStore(ChatStore&&)      = delete;
+  ChatStore(const ChatStore&) = delete;
+
+ private:
+  struct Conversation {
+    int log_fd = -1;
+    int idx_fd = -1;
+    uint64_t lines = 0;
+    uint64_t size  = 0;  // Bytes of the log
+  };
+
+  std::string directory;
+  std::unordered_map<uint64_t, Conversation> open;  // By lower account << 32 | higher
+
+  // Opens the files of a conversation, creating them if asked to; null if missing
+  Conversation* conversation(Id one, Id other, bool create);
+  void recover(Conversation& chat);
+  static void close(Conversation& chat);
+};
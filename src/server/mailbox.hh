@@ -0,0 +1,57 @@
+#pragma once
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <utility>
+
+/**
+ * Many-to-one queue between threads, each with its own event loop. The
+ * receiver watches fd() next to its sockets, edge-triggered, and takes
+ * everything at once when it becomes readable: the lock is only held
+ * to swap vectors, never while handling what is inside.
+ */
+template<typename T>
+class Mailbox {
+ public:
+  Mailbox() : event_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)} {}
+  ~Mailbox() { close(event_fd); }
+
+  [[nodiscard]] inline int fd() const { return event_fd; }
+
+  void push(T&& item) {
+    {
+      std::lock_guard lock(mutex);
+      items.push_back(std::move(item));
+    }
+    wake();
+  }
+
+  /**
+   * Makes fd() readable, which also serves to interrupt the receiver.
+   */
+  void wake() {
+    uint64_t one = 1;
+    (void)!write(event_fd, &one, sizeof(one));
+  }
+
+  /**
+   * \return Everything pushed since the last call, oldest first.
+   */
+  [[nodiscard]] std::vector<T> drain() {
+    uint64_t count;
+    (void)!read(event_fd, &count, sizeof(count));  // Re-arms the edge
+    std::lock_guard lock(mutex);
+    return std::exchange(items, {});
+  }
+
+  Mailbox(Mailbox&&)      = delete;
+  Mailbox(const Mailbox&) = delete;
+
+ private:
+  int event_fd;
+  std::mutex mutex;
+  std::vector<T> items;
+};
@@ -0,0 +1,294 @@
+#include "server.hh"
+
+#include <iostream>
+#include <span>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+#include <netinet/in.h>
+
+#include "../common/utils.hh"
+
+//                   ╔═════════╗
+//                   ║ Reactor ║
+//                   ╚═════════╝
+
+Server::Server(uint16_t port, size_t shard_count, std::chrono::milliseconds spectator_delay) {
+  if ((listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
+    std::cerr << "Could not create socket: " << std::strerror(errno) << '\n';
+    return;
+  }
+
+  int reuse = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in address{
+    .sin_family{AF_INET},
+    .sin_port{htons(port)},
+    .sin_addr{htonl(INADDR_ANY)}
+  };
+  if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 || listen(listen_fd, BACKLOG) == -1) {
+    std::cerr << "Could not listen on port " << port << ": " << std::strerror(errno) << '\n';
+    close(listen_fd);
+    listen_fd = -1;
+    return;
+  }
+
+  epoll_event event{.events = EPOLLIN | EPOLLET, .data{.fd = listen_fd}};
+  epoll_event mail{.events = EPOLLIN | EPOLLET, .data{.fd = inbox.fd()}};
+  if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) == -1
+      || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inbox.fd(), &mail) == -1) {
+    std::cerr << "Could not start event loop: " << std::strerror(errno) << '\n';
+    close(listen_fd);
+    listen_fd = -1;
+    return;
+  }
+
+  if (set_sigaction() == -1) {
+    std::cerr << "Could not set signal handlers\n";
+    close(listen_fd);
+    listen_fd = -1;
+    return;
+  }
+
+  for (size_t i = 0; i < shard_count; ++i)
+    shards.push_back(std::make_unique<Shard>(inbox, spectator_delay));
+
+  std::cout << "Listening on port " << port << " with " << shard_count << " shards\n";
+}
+
+Server::~Server() {
+  std::cout << "\nClosing server...\n";
+  shards.clear();  // Telling their own players
+  for (auto&& [fd, connection] : connections) {
+    if (connection.shard == -1)
+      write_message(fd, NM::Message(Networkable::Request::DISCONNECT));
+    close(fd);
+  }
+  if (epoll_fd != -1)
+    close(epoll_fd);
+  if (listen_fd != -1)
+    close(listen_fd);
+}
+
+void Server::run() {
+  if (listen_fd == -1) return;
+
+  array<epoll_event, MAX_EVENTS> events;
+
+  while (!is_interrupted) {
+    int ready = epoll_wait(epoll_fd, events.data(), MAX_EVENTS, -1);
+    if (ready == -1) {
+      if (errno == EINTR)
+        continue;
+      std::cerr << "Event loop failed: " << std::strerror(errno) << '\n';
+      return;
+    }
+
+    for (const epoll_event& event : std::span{events}.first(static_cast<size_t>(ready))) {
+      int fd = event.data.fd;
+      if (fd == listen_fd) {
+        acceptAll();
+        continue;
+      }
+      if (fd == inbox.fd()) {
+        collect();
+        continue;
+      }
+
+      // Handed over to a shard earlier in this batch, or dropped
+      auto it = connections.find(fd);
+      if (it == connections.end() || it->second.closing || it->second.shard != -1)
+        continue;
+
+      if (event.events & EPOLLOUT && !flush(fd)) {
+        drop(fd);
+        continue;
+      }
+      if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        receive(fd);
+    }
+
+    closeAll();
+    accounts.commit();  // Once for the whole batch
+  }
+}
+
+void Server::acceptAll() {
+  while (true) {
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd == -1) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      if (errno != EAGAIN)
+        std::cerr << "Could not accept connection: " << std::strerror(errno) << '\n';
+      return;  // Out of descriptors leaves the rest in the backlog until some close
+    }
+    set_nodelay(fd);  // Replies are small and awaited
+
+    // Registered once: edges are reported for both directions without further epoll_ctl
+    epoll_event event{.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data{.fd = fd}};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+      close(fd);
+      continue;
+    }
+    connections.emplace(fd, Connection{.session = ++sessions});
+  }
+}
+
+void Server::receive(int fd) {
+  for (NM::Message& message : read_messages(fd)) {
+    Connection& connection = connections.at(fd);
+    if (message.empty()) {
+      drop(fd);
+      return;
+    }
+
+    // Read along with the start of their match, which handles the rest
+    if (connection.shard != -1) {
+      shards[static_cast<size_t>(connection.shard)]->post(Mail::Forward{fd, connection.session, std::move(message)});
+      continue;
+    }
+
+    handle(fd, message);
+    if (connection.closing)
+      return;
+  }
+}
+
+void Server::send(int fd, NM::Message&& message) {
+  auto it = connections.find(fd);
+  if (it == connections.end() || it->second.closing)
+    return;
+  if (it->second.shard != -1) {
+    shards[static_cast<size_t>(it->second.shard)]->post(Mail::Deliver{fd, it->second.session, std::move(message)});
+    return;
+  }
+  if (!write_message(fd, std::move(message)) || pending(fd) > MAX_PENDING)
+    drop(fd);
+}
+
+void Server::sendTo(string_view username, NM::Message&& message) {
+  auto it = online.find(string{username});
+  if (it != online.end())
+    send(it->second, std::move(message));
+}
+
+void Server::sendLobby(const ServerLobby& lobby, const NM::Message& message, string_view except) {
+  // Clients in a match only listen to the game until they are back
+  for (auto&& member : lobby.getMembers())
+    if (auto it = online.find(member.name); member.name != except && it != online.end()
+        && connections.at(it->second).state != Connection::State::PLAYING)
+      send(it->second, NM::Message(message));
+}
+
+void Server::drop(int fd) {
+  Connection& connection = connections.at(fd);
+  if (connection.shard != -1)
+    return;  // Its shard notices too, and gives it back hung up
+  if (!connection.closing) {
+    connection.closing = true;
+    closing.push_back(fd);
+  }
+}
+
+void Server::closeAll() {
+  // Leaving lobbies notifies others, which may drop more connections
+  while (!closing.empty()) {
+    int fd = closing.back();
+    closing.pop_back();
+
+    logout(fd);
+    forget(fd);
+    close(fd);  // Also removes it from the epoll set
+    connections.erase(fd);
+  }
+}
+
+//                   ╔════════╗
+//                   ║ Shards ║
+//                   ╚════════╝
+
+void Server::startMatch(ServerLobby& lobby) {
+  auto least_busy = ranges::min_element(shards, {}, &Shard::sockets);
+  int index       = static_cast<int>(least_busy - shards.begin());
+
+  Mail::Start start{.match = ++last_match, .lobby = string{lobby.lobbyName()}, .parameters = lobby.parameters()};
+  for (auto&& member : lobby.getMembers()) {
+    int fd = online.at(member.name);
+    Connection& connection = connections.at(fd);
+    connection.state = Connection::State::PLAYING;
+    connection.shard = index;
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    Mail::Role role = member.slot == ServerLobby::Slot::LEFT  ? Mail::Role::LEFT
+                    : member.slot == ServerLobby::Slot::RIGHT ? Mail::Role::RIGHT
+                                                              : Mail::Role::SPECTATOR;
+    start.members.push_back({fd, connection.session, member.name, role, release(fd)});
+  }
+
+  lobby.setStarted(true);
+  (*least_busy)->post(std::move(start));
+}
+
+void Server::collect() {
+  auto ours = [this](int fd, uint64_t session) {
+    auto it = connections.find(fd);
+    return it != connections.end() && it->second.session == session;
+  };
+
+  for (Mail::ToAcceptor& mail : inbox.drain()) {
+    if (auto* back = std::get_if<Mail::Return>(&mail)) {
+      Connection& connection = connections.at(back->fd);
+      adopt(std::move(back->peer));
+      connection.shard = -1;
+      connection.state = lobbyOf(back->fd) ? Connection::State::LOBBY : Connection::State::MENU;
+
+      epoll_event event{.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data{.fd = back->fd}};
+      if (back->hung_up || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, back->fd, &event) == -1)
+        drop(back->fd);
+    } else if (auto* delivery = std::get_if<Mail::Deliver>(&mail)) {
+      if (ours(delivery->fd, delivery->session))
+        send(delivery->fd, std::move(delivery->message));
+    } else if (auto* forward = std::get_if<Mail::Forward>(&mail)) {
+      if (ours(forward->fd, forward->session))
+        handle(forward->fd, forward->message);
+    } else if (auto* over = std::get_if<Mail::Over>(&mail)) {
+      if (auto it = lobbies.find(over->lobby); it != lobbies.end())
+        it->second.setStarted(false);
+    } else if (auto* hashed = std::get_if<Mail::Hashed>(&mail)) {
+      if (ours(hashed->fd, hashed->session))
+        authenticated(hashed->fd, *hashed);
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  uint16_t port = PORT;
+  if (argc > 1)
+    if (auto value = NM::from_string(argv[1]))
+      port = static_cast<uint16_t>(*value);
+
+  // The acceptor has a core, shards take the others
+  size_t shard_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  if (argc > 2)
+    if (auto value = NM::from_string(argv[2]); value && *value > 0)
+      shard_count = static_cast<size_t>(*value);
+
+  // Spectators may be kept behind, so that they cannot tell the players what they saw
+  std::chrono::milliseconds spectator_delay{};
+  if (argc > 3)
+    if (auto value = NM::from_string(argv[3]); value && *value >= 0)
+      spectator_delay = std::chrono::seconds(*value);
+
+  try {
+    Server server(port, shard_count, spectator_delay);
+    server.run();
+  } catch (const std::runtime_error& error) {
+    std::cerr << error.what() << '\n';
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <sys/epoll.h>
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <map>
+#include <memory>
+
+#include "account_store.hh"
+#include "chat_store.hh"
+#include "server_lobby.hh"
+#include "server_shard.hh"
+#include "mailbox.hh"
+
+#include "../common/network_io.hh"
+#include "../common/scheduler.hh"
+#include "../common/serializer.hh"
+
+using std::string, std::string_view, std::vector, std::array;
+
+/**
+ * Everything known about a socket, from accept() to close().
+ */
+struct Connection {
+  enum class State : uint8_t {
+    ANONYMOUS,  // Not logged in yet
+    MENU,
+    LOBBY,
+    PLAYING
+  };
+
+  uint64_t session = 0;  // Tells apart connections reusing a descriptor
+  State state = State::ANONYMOUS;
+  string username;
+  string lobby;          // Name of the lobby they are in, if any
+  int shard     = -1;    // Shard running their match, which owns the socket meanwhile
+  bool hashing = false;  // A LOGIN or REGISTER is waiting for its password to be hashed
+  bool closing = false;  // Dropped once the current batch of events is handled
+};
+
+
+/**
+ * Reactor accepting and serving every connection outside of matches.
+ * Sockets are non-blocking and registered once, edge-triggered, for both
+ * input and output: an idle connection costs no syscall at all, and each
+ * wakeup drains the socket until it would block.
+ *
+ * Matches run on shards, each an event loop on its own thread, to which
+ * the sockets of a match are handed over when it starts. Accounts, chats
+ * and lobbies stay here: what either side needs of the other goes
+ * through their mailboxes.
+ *
+ * Passwords are hashed on a pool of workers, slow as hashing is on
+ * purpose, and the result mailed back like a shard would: the event
+ * loop goes on serving everyone else meanwhile.
+ */
+class Server : protected Networkable {
+  static constexpr int    MAX_EVENTS  = 256;       // Events handled per epoll_wait
+  static constexpr int    BACKLOG     = 1024;
+  static constexpr size_t MAX_PENDING = 8 << 20;   // Unsent bytes after which a client is too slow to keep
+
+  static constexpr string_view ACCOUNTS = "./accounts";  // Files of the account store, without extension
+  static constexpr string_view CHATS    = "./chats";     // Directory of the chat store
+
+  int listen_fd = -1;
+  int epoll_fd  = -1;
+
+  std::unordered_map<int, Connection> connections;
+  vector<int> closing;
+  uint64_t sessions = 0;
+
+  Mailbox<Mail::ToAcceptor> inbox;
+  vector<std::unique_ptr<Shard>> shards;
+  uint64_t last_match = 0;
+  NM::Scheduler hashers;  // After inbox, as workers finish their tasks before it is destroyed
+
+  AccountStore accounts{string(ACCOUNTS)};
+  std::unordered_map<string, int> online;  // Username to socket
+  std::map<string, ServerLobby> lobbies;   // Sorted for listing
+  ChatStore chats{string(CHATS)};
+
+  // --------- Reactor ---------
+
+  void acceptAll();
+  void receive(int fd);
+  void drop(int fd);
+  void closeAll();
+  void collect();
+
+  /**
+   * Queues a message, dropping the recipient if the connection broke
+   * or if they stopped reading long ago.
+   */
+  void send(int fd, NM::Message&& message);
+  void sendTo(string_view username, NM::Message&& message);
+  void sendLobby(const ServerLobby& lobby, const NM::Message& message, string_view except = {});
+
+  // --------- Dispatch ---------
+
+  void handle(int fd, const NM::Message& message);
+
+  void login(int fd, const NM::Message& message);
+  void signup(int fd, const NM::Message& message);
+  void logout(int fd);
+
+  /**
+   * Hashes or checks the password of a LOGIN or REGISTER on a worker,
+   * then authenticated() answers it once the result is mailed back.
+   */
+  void hash(int fd, Mail::Hashed&& job);
+  void authenticated(int fd, const Mail::Hashed& job);
+
+  void updateRelation(int fd, const NM::Message& message);
+  void sendChat(int fd, const NM::Message& message);
+  void loadChat(int fd, const NM::Message& message);
+
+  void listMatches(int fd);
+  void host(int fd, const NM::Message& message);
+  void join(int fd, const NM::Message& message);
+  void joinOnInvite(int fd, const NM::Message& message);
+  void enter(int fd, ServerLobby& lobby);
+  void quitLobby(int fd);
+  void updateLobby(int fd, const NM::Message& message);
+  void updateMember(int fd, const NM::Message& message);
+
+  void handleGame(int fd, const NM::Message& message);
+
+  /**
+   * Hands a lobby's members over to the least busy shard, which starts
+   * their match.
+   */
+  void startMatch(ServerLobby& lobby);
+
+  [[nodiscard]] NM::Message::Account account(const string& username) const;
+  [[nodiscard]] ServerLobby* lobbyOf(int fd);
+
+ public:
+  /**
+   * \param Port to listen on.
+   * \param Event loops running matches, beside the acceptor's.
+   * \param How long spectators see moves after the players do.
+   */
+  Server(uint16_t port, size_t shard_count, std::chrono::milliseconds spectator_delay = {});
+  ~Server();
+
+  void run();
+
+  Server(Server&&)      = delete;
+  Server(const Server&) = delete;
+};
@@ -0,0 +1,251 @@
+#include "server_game.hh"
+
+#include <algorithm>
+
+using Request = Networkable::Request;
+using NM::Message;
+using Cell    = Message::ServerFire::Cell;
+
+//                   ╔═══════╗
+//                   ║ Setup ║
+//                   ╚═══════╝
+
+void ServerGame::Side::equip(Faction faction) {
+  using enum Ability::Type;
+  inventory = Boat::createInventory(faction);
+  switch (faction) {
+    case Faction::PIRATE:
+      abilities = {Basic, Diagonal, XBomb};
+      break;
+    case Faction::CAPTAIN:
+      abilities = {Basic, Linear, PlusBomb};
+      break;
+    case Faction::CLASSIC:
+    default:
+      abilities = {Basic};
+      break;
+  }
+}
+
+ServerGame::ServerGame(Lobby::parameter_t parameters, string_view left, string_view right)
+    : mode{std::get<GameMode>(parameters)}, timer_type{std::get<Timer::Type>(parameters)},
+      names{string{left}, string{right}} {
+  for (Side& player : sides) {
+    // Classic fleets are fixed, the client skips choosing a faction
+    if (mode == GameMode::CLASSIC) {
+      player.stage = GameStage::SELECTION;
+      player.equip(Faction::CLASSIC);
+    } else {
+      player.stage = GameStage::FACTIONSELECT;
+    }
+  }
+}
+
+//                   ╔══════════╗
+//                   ║ Dispatch ║
+//                   ╚══════════╝
+
+vector<ServerGame::Delivery> ServerGame::handle(Seat seat, const Message& message) {
+  if (_is_finished)
+    return {};
+  if (message.request() == Request::OUT_OF_TIME)
+    return outOfTime(seat);
+  if (message.request() != Request::GAME)
+    return {};
+
+  switch (side(seat).stage) {
+    using enum GameStage;
+    case FACTIONSELECT:
+      return selectFaction(seat, message);
+    case SELECTION:
+      return selectBoat(seat, message);
+    case PLACEMENT:
+      return place(seat, message);
+    case ATTACKSELECT:
+      return selectAbility(seat, message);
+    case COMBAT:
+      return fire(seat, message);
+    case WAITING:
+    case OTHERTURN:
+    case GAMEFINISHED:
+    case SPECTATING:
+    default:
+      return {};
+  }
+}
+
+vector<ServerGame::Delivery> ServerGame::forfeit(Seat seat) {
+  vector<Delivery> out;
+  if (!_is_finished)
+    end(seat == Seat::LEFT ? Victor::RIGHT : Victor::LEFT, out);
+  return out;
+}
+
+//                   ╔═══════════╗
+//                   ║ Placement ║
+//                   ╚═══════════╝
+
+vector<ServerGame::Delivery> ServerGame::selectFaction(Seat seat, const Message& message) {
+  auto faction = message.extract<Message::Faction>();
+  if (!faction || (faction->data() != Faction::PIRATE && faction->data() != Faction::CAPTAIN))
+    return {};
+
+  side(seat).equip(faction->data());
+  side(seat).stage = GameStage::SELECTION;
+  return {{audience(seat), message}};
+}
+
+vector<ServerGame::Delivery> ServerGame::selectBoat(Seat seat, const Message& message) {
+  Side& player   = side(seat);
+  auto selection = message.extract<Message::BoatSelection>();
+  if (!selection || ranges::find(player.inventory, selection->data()) == player.inventory.end())
+    return {};
+
+  player.selected = selection->data();
+  player.stage    = GameStage::PLACEMENT;
+  return {{audience(seat), message}};
+}
+
+bool ServerGame::fits(const Side& player, const vector<BoardCoordinates>& cells) const {
+  Bitboard mask = Bitboard::of(cells);
+  // Fewer cells in the mask than given: some are off the board, or repeated
+  if (mask.count() != cells.size() || !(mask & player.board.ships).empty())
+    return false;
+  // Classic ships may not touch, not even by a side
+  return mode != GameMode::CLASSIC || (mask.neighbours() & player.board.ships).empty();
+}
+
+vector<ServerGame::Delivery> ServerGame::place(Seat seat, const Message& message) {
+  Side& player      = side(seat);
+  auto confirmation = message.extract<Message::Confirmation>();
+  if (!confirmation)
+    return {};
+
+  auto&& [cells, id, type] = confirmation->data();
+  if (type != player.selected || cells.empty() || id <= 0 || ranges::find(player.fleet, id, &Ship::id) != player.fleet.end()
+      || !Boat::isCorrect(type, cells) || !fits(player, cells))
+    return {};
+
+  Bitboard mask = Bitboard::of(cells);
+  player.board.ships |= mask;
+  player.fleet.push_back({id, mask});
+  player.inventory.erase(ranges::find(player.inventory, type));
+  player.selected.reset();
+  player.stage = player.inventory.empty() ? GameStage::WAITING : GameStage::SELECTION;
+
+  vector<Delivery> out{{audience(seat), message}};
+  if (ranges::all_of(sides, [](const Side& s) { return s.stage == GameStage::WAITING; })) {
+    Side& first = side(Seat::LEFT);
+    first.stage  = mode == GameMode::CLASSIC ? GameStage::COMBAT : GameStage::ATTACKSELECT;
+    first.energy = 1;
+    side(Seat::RIGHT).stage = GameStage::OTHERTURN;
+    out.push_back({Audience::LEFT, Message(Request::GAME, Message::StartCombat(true))});
+    out.push_back({Audience::RIGHT, Message(Request::GAME, Message::StartCombat(false))});
+  }
+  return out;
+}
+
+//                   ╔════════╗
+//                   ║ Combat ║
+//                   ╚════════╝
+
+vector<ServerGame::Delivery> ServerGame::selectAbility(Seat seat, const Message& message) {
+  Side& player = side(seat);
+  auto ability = message.extract<Message::AbilitySelection>();
+  if (!ability || ranges::find(player.abilities, ability->data()) == player.abilities.end()
+      || (ability->data() != Ability::Type::Basic && player.energy < ABILITY_COST))
+    return {};
+
+  player.ability = ability->data();
+  player.stage   = GameStage::COMBAT;
+  return {{audience(seat), message}};
+}
+
+vector<ServerGame::Delivery> ServerGame::fire(Seat seat, const Message& message) {
+  Side& shooter = side(seat);
+  Side& target  = side(other(seat));
+  auto shot     = message.extract<Message::ClientFire>();
+  if (!shot)
+    return {};
+
+  auto&& [area, type] = shot->data();
+  Ability::Type used  = mode == GameMode::CLASSIC ? Ability::Type::Basic : shooter.ability;
+  if (area.empty() || type != used || area[0].x() >= BOARDSIZE || area[0].y() >= BOARDSIZE)
+    return {};
+
+  // Only the origin is trusted, the rest of the area follows from the ability
+  BoardMasks& board = target.board;
+  Bitboard reach    = Ability::footprint(used, area[0]) & ~board.known;
+  board.known |= reach;
+
+  vector<Cell> revealed;
+  for (BoardCoordinates c : reach & ~board.ships)
+    revealed.push_back({c, 0, CellType::OCEAN});
+  for (const Ship& ship : target.fleet) {
+    Bitboard hit = ship.cells & reach;
+    if (hit.empty())
+      continue;
+    bool sunk = (ship.cells & ~board.known).empty();
+    if (sunk)
+      board.sunk |= ship.cells;
+    for (BoardCoordinates c : sunk ? ship.cells : hit)
+      revealed.push_back({c, ship.id, sunk ? CellType::SUNK : CellType::HIT});
+  }
+
+  // Shooting where everything is known already is a mistake, not a move
+  if (revealed.empty())
+    return {};
+
+  if (used != Ability::Type::Basic)
+    shooter.energy -= ABILITY_COST;
+  shooter.ability = Ability::Type::Basic;
+
+  vector<Delivery> out;
+  pass(seat, std::move(revealed), out);
+  return out;
+}
+
+vector<ServerGame::Delivery> ServerGame::outOfTime(Seat seat) {
+  GameStage stage = side(seat).stage;
+  if (turn != seat || (stage != GameStage::ATTACKSELECT && stage != GameStage::COMBAT))
+    return {};
+
+  if (timer_type == Timer::Type::GLOBAL)
+    return forfeit(seat);
+
+  vector<Delivery> out;
+  pass(seat, {}, out);  // Only the turn was lost
+  return out;
+}
+
+void ServerGame::pass(Seat shooter, vector<Cell>&& cells, vector<Delivery>& out) {
+  Seat victim  = other(shooter);
+  bool over    = side(victim).board.afloat().empty();
+  Side& next   = side(victim);
+
+  side(shooter).stage = GameStage::OTHERTURN;
+  if (!over) {
+    turn        = victim;
+    next.energy = std::min(next.energy + 1, MAX_ENERGY);
+    next.stage  = mode == GameMode::CLASSIC ? GameStage::COMBAT : GameStage::ATTACKSELECT;
+  }
+
+  // Spectators watch from the left player's side
+  Message::ServerFire seen(cells, victim == Seat::LEFT, !over && victim == Seat::LEFT, 0);
+  out.push_back({audience(shooter), Message(Request::GAME, Message::ServerFire(cells, false, false, side(shooter).energy))});
+  out.push_back({audience(victim), Message(Request::GAME, Message::ServerFire(cells, true, !over, next.energy))});
+  out.push_back({Audience::SPECTATORS, Message(Request::GAME, seen)});
+  moves.push_back(std::move(seen));
+
+  if (over)
+    end(shooter == Seat::LEFT ? Victor::LEFT : Victor::RIGHT, out);
+}
+
+void ServerGame::end(Victor victor, vector<Delivery>& out) {
+  setVictor(victor);
+  for (Side& player : sides)
+    player.stage = GameStage::GAMEFINISHED;
+
+  out.push_back({Audience::EVERYONE, Message(Request::GAMEOVER, Message::GameEnd(victor))});
+  out.push_back({Audience::EVERYONE, Message(Request::RECORDING, Message::Recording(names[0], names[1], moves))});
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <optional>
+
+#include "../common/board_common.hh"
+#include "../common/bitboard.hh"
+#include "../common/lobby_common.hh"
+#include "../common/boat.hh"
+#include "../common/ability.hh"
+#include "../common/serializer.hh"
+
+using std::string, std::string_view, std::vector, std::array;
+
+/**
+ * Authoritative state of one match: both fleets, whose turn it is, and
+ * the rules deciding what each move does. It knows nothing of sockets:
+ * handling a move returns who must be told what, so that whoever runs
+ * the match can deliver it.
+ */
+class ServerGame : public GameModel {
+ public:
+  enum class Seat : uint8_t {
+    LEFT,
+    RIGHT
+  };
+
+  enum class Audience : uint8_t {
+    LEFT,
+    RIGHT,
+    SPECTATORS,
+    EVERYONE
+  };
+
+  struct Delivery {
+    Audience to;
+    NM::Message message;
+  };
+
+  static constexpr int ABILITY_COST = 2;  // Anything but a basic shot
+  static constexpr int MAX_ENERGY   = 5;
+
+  ServerGame(Lobby::parameter_t parameters, string_view left, string_view right);
+
+  /**
+   * Applies a move, GAME or OUT_OF_TIME, from one of the players.
+   * Moves that are illegal, or out of turn, are ignored.
+   *
+   * \return Messages to deliver, empty if nothing happened.
+   */
+  [[nodiscard]] vector<Delivery> handle(Seat seat, const NM::Message& message);
+
+  /**
+   * Ends the match in favour of the other player.
+   *
+   * \return Messages to deliver, empty if it was already over.
+   */
+  [[nodiscard]] vector<Delivery> forfeit(Seat seat);
+
+  [[nodiscard]] inline bool finished() const { return _is_finished; }
+
+  /**
+   * \return Whose turn it is once combat started, none before or after.
+   */
+  [[nodiscard]] inline std::optional<Seat> playing() const {
+    GameStage stage = sides.at(static_cast<size_t>(turn)).stage;
+    if (_is_finished || (stage != GameStage::ATTACKSELECT && stage != GameStage::COMBAT))
+      return std::nullopt;
+    return turn;
+  }
+
+ private:
+  struct Ship {
+    int id;
+    Bitboard cells;
+  };
+
+  struct Side {
+    GameStage stage;
+    vector<Boat::Type> inventory;
+    vector<Ability::Type> abilities;
+    std::optional<Boat::Type> selected;  // Ship being placed
+    Ability::Type ability = Ability::Type::Basic;
+    int energy = 0;
+
+    BoardMasks board;
+    vector<Ship> fleet;
+
+    void equip(Faction faction);
+  };
+
+  GameMode mode;
+  Timer::Type timer_type;
+  array<string, 2> names;
+  array<Side, 2> sides;
+  Seat turn = Seat::LEFT;
+  vector<NM::Message::ServerFire> moves;  // As spectators saw them, for the replay
+
+  [[nodiscard]] inline Side& side(Seat seat) { return sides.at(static_cast<size_t>(seat)); }
+  [[nodiscard]] static inline Seat other(Seat seat) { return seat == Seat::LEFT ? Seat::RIGHT : Seat::LEFT; }
+  [[nodiscard]] static inline Audience audience(Seat seat) { return seat == Seat::LEFT ? Audience::LEFT : Audience::RIGHT; }
+
+  [[nodiscard]] vector<Delivery> selectFaction(Seat seat, const NM::Message& message);
+  [[nodiscard]] vector<Delivery> selectBoat(Seat seat, const NM::Message& message);
+  [[nodiscard]] vector<Delivery> place(Seat seat, const NM::Message& message);
+  [[nodiscard]] vector<Delivery> selectAbility(Seat seat, const NM::Message& message);
+  [[nodiscard]] vector<Delivery> fire(Seat seat, const NM::Message& message);
+  [[nodiscard]] vector<Delivery> outOfTime(Seat seat);
+
+  /**
+   * \return Whether a ship may lie on these cells of a side's board.
+   */
+  [[nodiscard]] bool fits(const Side& side, const vector<BoardCoordinates>& cells) const;
+
+  /**
+   * Gives the turn to the other player, telling everyone what the last
+   * shot revealed.
+   */
+  void pass(Seat shooter, vector<NM::Message::ServerFire::Cell>&& cells, vector<Delivery>& out);
+
+  void end(Victor victor, vector<Delivery>& out);
+};
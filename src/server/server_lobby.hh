@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include "../common/lobby_common.hh"
+#include "../common/serializer.hh"
+
+using std::string, std::string_view, std::vector;
+
+/**
+ * Server-side lobby: its parameters, who is in it and where they sit.
+ * The first member is the host, who alone changes parameters and starts
+ * the match. Members are few, at most MAX_PLAYERS, so they are scanned.
+ */
+class ServerLobby : public Lobby {
+ public:
+  using Slot = NM::Message::SlotLobby::Slot;
+
+  struct Member {
+    string name;
+    Slot slot;
+  };
+
+  ServerLobby(string_view lobby_name, string_view lobby_password, string_view host) : members{{string{host}, Slot::SPECTATOR}} {
+    name = {};
+    ranges::copy(lobby_name.substr(0, LOBBY_NAME_MAXSIZE - 1), name.data());  // Clients read it up to a NUL
+    password = lobby_password;
+  }
+
+  [[nodiscard]] inline string_view lobbyName()  const { return {name.data(), strnlen(name.data(), name.size())}; }
+  [[nodiscard]] inline string_view host()       const { return members.front().name; }
+  [[nodiscard]] inline bool        started()    const { return is_started; }
+  [[nodiscard]] inline bool        full()       const { return members.size() >= MAX_PLAYERS; }
+  [[nodiscard]] inline bool        empty()      const { return members.empty(); }
+  [[nodiscard]] inline const auto& getMembers() const { return members; }
+
+  [[nodiscard]] inline bool checkPassword(string_view attempt) const { return password.empty() || attempt == password; }
+
+  inline void setStarted(bool started) { is_started = started; }
+
+  inline void add(string_view member) { members.push_back({string{member}, Slot::SPECTATOR}); }
+
+  /**
+   * Removes a member, the next one in line becoming host if needed.
+   *
+   * \return false if they were not in the lobby.
+   */
+  inline bool remove(string_view member) {
+    return std::erase_if(members, [&](const Member& m) { return m.name == member; }) > 0;
+  }
+
+  /**
+   * Seats a member, players' seats being exclusive.
+   *
+   * \return false if the seat is taken or they are not in the lobby.
+   */
+  inline bool seat(string_view member, Slot slot) {
+    auto it = ranges::find(members, member, &Member::name);
+    if (it == members.end() || slot == Slot::QUITTING)
+      return false;
+    if (slot != Slot::SPECTATOR && it->slot != slot && player(slot))
+      return false;
+    it->slot = slot;
+    return true;
+  }
+
+  /**
+   * \return Name of the member sitting there, nullptr if free.
+   */
+  [[nodiscard]] inline const string* player(Slot slot) const {
+    auto it = ranges::find(members, slot, &Member::slot);
+    return it == members.end() ? nullptr : &it->name;
+  }
+
+  [[nodiscard]] inline NM::Message::HostLobby details() const { return {lobbyName(), password}; }
+
+  [[nodiscard]] inline NM::Message::JoinLobby fullDetails() const {
+    NM::Message::JoinLobby details(this->details(), NM::Message::LobbyParameters(parameters()));
+    for (auto&& member : members)
+      details.push_back({member.name, member.slot});
+    return details;
+  }
+
+  [[nodiscard]] inline NM::Message::Matches::Match summary() const {
+    NM::Message::Matches::Match match{};
+    match.name     = name;
+    match.players  = static_cast<uint8_t>(members.size());
+    match.started  = is_started;
+    match.password = !password.empty();
+    return match;
+  }
+
+ private:
+  vector<Member> members;
+  bool is_started = false;
+};
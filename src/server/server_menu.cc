@@ -0,0 +1,406 @@
+#include "server.hh"
+
+#include <algorithm>
+#include <ranges>
+
+#include "../common/utils.hh"
+
+using Request = Networkable::Request;
+using NM::Message;
+
+//                   ╔══════════╗
+//                   ║ Dispatch ║
+//                   ╚══════════╝
+
+void Server::handle(int fd, const Message& message) {
+  if (NM::to_underlying(message.request()) >= NM::to_underlying(Request::R_SENTINEL)) {
+    drop(fd);
+    return;
+  }
+
+  Connection& connection = connections.at(fd);
+  bool anonymous = connection.state == Connection::State::ANONYMOUS;
+
+  switch (message.request()) {
+    using enum Networkable::Request;
+    case LOGIN:
+      login(fd, message);
+      break;
+    case REGISTER:
+      signup(fd, message);
+      break;
+    case LOGOUT:
+      logout(fd);
+      break;
+    case DISCONNECT:
+      drop(fd);
+      break;
+    case UPDATE_RELATIONSHIPS:
+      if (!anonymous) updateRelation(fd, message);
+      break;
+    case CHAT_MESSAGE:
+      if (!anonymous) sendChat(fd, message);
+      break;
+    case LOAD_CHAT:
+      if (!anonymous) loadChat(fd, message);
+      break;
+    case JOINONINVITE:
+      if (!anonymous) joinOnInvite(fd, message);
+      break;
+    case HOST:
+      if (!anonymous) host(fd, message);
+      break;
+    case JOIN:
+      if (!anonymous) join(fd, message);
+      break;
+    case GET_MATCHES:
+      if (!anonymous) listMatches(fd);
+      break;
+    case QUIT_LOBBY:
+      if (!anonymous) quitLobby(fd);
+      break;
+    case UPDATE_LOBBY:
+      if (!anonymous) updateLobby(fd, message);
+      break;
+    case UPDATE_LOBBY_MEMBER:
+      if (!anonymous) updateMember(fd, message);
+      break;
+    case ACCEPT_GAME:
+    case REJECT_GAME:
+    case START_GAME:
+    case START_SPECTATING:
+    case INVITE:
+    case GAME:
+    case OUT_OF_TIME:
+    case BACK_TO_LOBBY:
+    case RECORDING:
+      if (!anonymous) handleGame(fd, message);
+      break;
+    case CLOCK:
+      if (Message answer = answerClock(message); !answer.empty())
+        send(fd, std::move(answer));
+      break;
+    case GAMEOVER:
+    case HELLO:  // Negotiated by Networkable
+    default:
+      break;
+  }
+}
+
+void Server::handleGame(int fd, const Message& message) {
+  ServerLobby* lobby = lobbyOf(fd);
+  if (message.request() != Request::START_GAME || !lobby || lobby->started() || lobby->host() != connections.at(fd).username)
+    return;  // Moves are for the shard running the match, once it started
+
+  if (lobby->player(ServerLobby::Slot::LEFT) && lobby->player(ServerLobby::Slot::RIGHT))
+    startMatch(*lobby);
+}
+
+//                   ╔══════════╗
+//                   ║ Sessions ║
+//                   ╚══════════╝
+
+Message::Account Server::account(const string& username) const {
+  AccountStore::Id id = *accounts.find(username);
+  auto names = [&](AccountStore::List list) {
+    return accounts.list(id, list) | std::views::transform([&](AccountStore::Id other) -> string_view { return accounts.name(other); });
+  };
+  using enum AccountStore::List;
+  return Message::Account(username, names(FRIENDS), names(INBOUND), names(OUTBOUND), names(GAME_REQUESTS));
+}
+
+void Server::login(int fd, const Message& message) {
+  Connection& connection = connections.at(fd);
+  auto credentials = message.extract_view<Message::Credentials>();
+
+  auto id = credentials ? accounts.find(credentials->name) : std::nullopt;
+  if (connection.state != Connection::State::ANONYMOUS || connection.hashing || !id || online.contains(accounts.name(*id))) {
+    send(fd, Message(Request::LOGIN));  // No body, the client stays on the login screen
+    return;
+  }
+
+  hash(fd, {fd, connection.session, Request::LOGIN, accounts.name(*id), string{credentials->password}, accounts.passwordHash(*id)});
+}
+
+void Server::signup(int fd, const Message& message) {
+  Connection& connection = connections.at(fd);
+  auto credentials = message.extract_view<Message::Credentials>();
+
+  if (connection.state != Connection::State::ANONYMOUS || connection.hashing || !credentials || credentials->name.empty()
+      || credentials->name.size() > AccountStore::MAX_NAME || credentials->name.find(ILLEGALCHARACTERS::SPACE) != string_view::npos || accounts.find(credentials->name)) {
+    send(fd, Message(Request::REGISTER));
+    return;
+  }
+
+  hash(fd, {fd, connection.session, Request::REGISTER, string{credentials->name}, string{credentials->password}, {}});
+}
+
+void Server::hash(int fd, Mail::Hashed&& job) {
+  connections.at(fd).hashing = true;
+  hashers.push([this, job = std::make_unique<Mail::Hashed>(std::move(job))]() mutable {
+    if (job->request == Request::LOGIN) {
+      job->accepted = AccountStore::checkPassword(job->hash, job->password);
+    } else if (auto hashed = AccountStore::hashPassword(job->password)) {
+      job->hash     = std::move(*hashed);
+      job->accepted = true;
+    }
+    job->password.clear();
+    inbox.push(std::move(*job));
+  });
+}
+
+void Server::authenticated(int fd, const Mail::Hashed& job) {
+  Connection& connection = connections.at(fd);
+  connection.hashing = false;
+  if (connection.closing)
+    return;
+
+  // Someone may have taken the name, or logged in with it, meanwhile
+  std::optional<AccountStore::Id> id;
+  if (job.accepted && connection.state == Connection::State::ANONYMOUS && !online.contains(job.name))
+    id = job.request == Request::LOGIN ? accounts.find(job.name) : accounts.create(job.name, job.hash);
+  if (!id) {
+    send(fd, Message(job.request));
+    return;
+  }
+
+  connection.state    = Connection::State::MENU;
+  connection.username = accounts.name(*id);
+  online.emplace(connection.username, fd);
+  send(fd, Message(job.request, account(connection.username)));
+}
+
+void Server::logout(int fd) {
+  Connection& connection = connections.at(fd);
+  if (connection.state == Connection::State::ANONYMOUS)
+    return;
+
+  quitLobby(fd);
+  online.erase(connection.username);
+  connection.username.clear();
+  connection.state = Connection::State::ANONYMOUS;
+}
+
+//                   ╔═════════╗
+//                   ║ Friends ║
+//                   ╚═════════╝
+
+void Server::updateRelation(int fd, const Message& message) {
+  using enum Message::Relationship::Kind;
+  using Relationship = Message::Relationship;
+
+  const string& you = connections.at(fd).username;
+  auto relation = message.extract<Relationship>();
+  if (!relation)
+    return;
+
+  auto&& [sender, other, kind] = relation->data();
+  auto them = accounts.find(other);
+  if (sender != you || other == you || !them)
+    return;
+
+  using enum AccountStore::List;
+  AccountStore::Id me = *accounts.find(you);
+  auto has    = [&](AccountStore::List list) { return accounts.has(me, list, *them); };
+  auto notify = [&](Relationship::Kind mine_kind, Relationship::Kind their_kind) {
+    send(fd, Message(Request::UPDATE_RELATIONSHIPS, Relationship(you, other, mine_kind)));
+    sendTo(other, Message(Request::UPDATE_RELATIONSHIPS, Relationship(other, you, their_kind)));
+  };
+
+  switch (kind) {
+    case SENDING:
+      if (has(FRIENDS) || has(OUTBOUND) || has(INBOUND))
+        break;
+      accounts.add(me, OUTBOUND, *them);
+      accounts.add(*them, INBOUND, me);
+      notify(SENDING, RECEIVING);
+      break;
+    case ACCEPTING:
+      if (!accounts.remove(me, INBOUND, *them))
+        break;
+      accounts.remove(*them, OUTBOUND, me);
+      accounts.add(me, FRIENDS, *them);
+      accounts.add(*them, FRIENDS, me);
+      notify(ACCEPTING, ACCEPTING);
+      break;
+    case REJECTING:
+      if (!accounts.remove(me, INBOUND, *them))
+        break;
+      accounts.remove(*them, OUTBOUND, me);
+      notify(REJECTING, REJECTING);
+      break;
+    case REMOVING:
+      if (!accounts.remove(me, FRIENDS, *them))
+        break;
+      accounts.remove(*them, FRIENDS, me);
+      notify(REMOVING, REMOVING);
+      break;
+    case SENDINGGAME:
+      // Invitations only make sense from a lobby, to a friend
+      if (!has(FRIENDS) || accounts.has(*them, GAME_REQUESTS, me) || !lobbyOf(fd))
+        break;
+      accounts.add(*them, GAME_REQUESTS, me);
+      sendTo(other, Message(Request::UPDATE_RELATIONSHIPS, Relationship(other, you, SENDINGGAME)));
+      break;
+    case RECEIVING:
+    case JOINGAME:
+    default:
+      break;
+  }
+}
+
+void Server::sendChat(int fd, const Message& message) {
+  const string& you = connections.at(fd).username;
+  auto update = message.extract<Message::ChatUpdate>();
+  if (!update)
+    return;
+
+  auto&& [sender, receiver, line] = update->data();
+  auto them = accounts.find(receiver);
+  if (sender != you || !them || !accounts.has(*accounts.find(you), AccountStore::List::FRIENDS, *them)
+      || sender.size() + 2 >= ChatStore::MAX_LINE)
+    return;
+
+  // Cut to what the log keeps after the name, without splitting a UTF-8 sequence
+  string_view kept = line;
+  if (size_t room = ChatStore::MAX_LINE - sender.size() - 2; kept.size() > room) {
+    while (room > 0 && (static_cast<unsigned char>(kept[room]) & 0xC0) == 0x80)
+      --room;
+    kept = kept.substr(0, room);
+  }
+
+  chats.append(*accounts.find(you), *them, sender + ": " + string{kept});
+  sendTo(receiver, Message(Request::CHAT_MESSAGE, Message::ChatUpdate(sender, receiver, kept)));
+}
+
+void Server::loadChat(int fd, const Message& message) {
+  const string& you = connections.at(fd).username;
+  auto request = message.extract_view<Message::ChatLog>();
+  if (!request)
+    return;
+
+  string recipient{request->recipient};
+  auto them = accounts.find(recipient);
+  ChatStore::Page page = them ? chats.page(*accounts.find(you), *them, request->cursor) : ChatStore::Page{};
+  send(fd, Message(Request::LOAD_CHAT, Message::ChatLog(recipient, page.lines, page.first)));
+}
+
+//                   ╔═════════╗
+//                   ║ Lobbies ║
+//                   ╚═════════╝
+
+ServerLobby* Server::lobbyOf(int fd) {
+  auto it = lobbies.find(connections.at(fd).lobby);
+  return it == lobbies.end() ? nullptr : &it->second;
+}
+
+void Server::listMatches(int fd) {
+  Message::Matches matches;
+  for (auto&& [name, lobby] : lobbies)
+    matches.push_back(lobby.summary());
+  send(fd, Message(Request::GET_MATCHES, std::move(matches)));
+}
+
+void Server::host(int fd, const Message& message) {
+  Connection& connection = connections.at(fd);
+  auto details = message.extract<Message::HostLobby>();
+  if (connection.state != Connection::State::MENU || !details)
+    return;
+
+  auto&& [name_array, password] = details->data();
+  string name{name_array.data(), strnlen(name_array.data(), name_array.size())};
+  if (name.empty() || name.size() >= Lobby::LOBBY_NAME_MAXSIZE || lobbies.contains(name))
+    return;
+
+  ServerLobby& lobby = lobbies.try_emplace(name, name, password, connection.username).first->second;
+  connection.state = Connection::State::LOBBY;
+  connection.lobby = name;
+  send(fd, Message(Request::HOST, lobby.details()));
+  send(fd, Message(Request::UPDATE_LOBBY_MEMBER, Message::SlotLobby(connection.username)));
+}
+
+void Server::join(int fd, const Message& message) {
+  auto details = message.extract<Message::HostLobby>();
+  if (connections.at(fd).state != Connection::State::MENU || !details)
+    return;
+
+  auto&& [name_array, password] = details->data();
+  auto it = lobbies.find(string{name_array.data(), strnlen(name_array.data(), name_array.size())});
+  if (it == lobbies.end() || !it->second.checkPassword(password))
+    return;
+
+  enter(fd, it->second);
+}
+
+void Server::joinOnInvite(int fd, const Message& message) {
+  const string& you = connections.at(fd).username;
+  auto invite = message.extract<Message::Relationship>();
+  if (connections.at(fd).state != Connection::State::MENU || !invite)
+    return;
+
+  auto&& [sender, inviter, kind] = invite->data();
+  auto host = accounts.find(inviter);
+  if (sender != you || !host || !accounts.remove(*accounts.find(you), AccountStore::List::GAME_REQUESTS, *host))
+    return;
+
+  auto host_fd = online.find(inviter);
+  if (host_fd == online.end())
+    return;
+  if (ServerLobby* lobby = lobbyOf(host_fd->second))
+    enter(fd, *lobby);  // The invitation stands for the password
+}
+
+void Server::enter(int fd, ServerLobby& lobby) {
+  Connection& connection = connections.at(fd);
+  if (lobby.full() || lobby.started())
+    return;
+
+  lobby.add(connection.username);
+  connection.state = Connection::State::LOBBY;
+  connection.lobby = lobby.lobbyName();
+  send(fd, Message(Request::JOIN, lobby.fullDetails()));
+  sendLobby(lobby, Message(Request::UPDATE_LOBBY_MEMBER, Message::SlotLobby(connection.username)), connection.username);
+}
+
+void Server::quitLobby(int fd) {
+  Connection& connection = connections.at(fd);
+  ServerLobby* lobby = lobbyOf(fd);
+  connection.lobby.clear();
+  if (connection.state == Connection::State::LOBBY)
+    connection.state = Connection::State::MENU;
+  if (!lobby || !lobby->remove(connection.username))
+    return;
+
+  if (!connection.closing)
+    send(fd, Message(Request::QUIT_LOBBY));
+  if (lobby->empty())
+    lobbies.erase(string{lobby->lobbyName()});
+  else
+    sendLobby(*lobby, Message(Request::UPDATE_LOBBY_MEMBER, Message::SlotLobby(connection.username, ServerLobby::Slot::QUITTING)));
+}
+
+void Server::updateLobby(int fd, const Message& message) {
+  ServerLobby* lobby = lobbyOf(fd);
+  auto params = message.extract<Message::LobbyParameters>();
+  if (!lobby || !params || lobby->started() || lobby->host() != connections.at(fd).username)
+    return;
+
+  auto&& [game_time, turn_time, tt, gt] = params->data();
+  if (lobby->updateParameters({game_time, turn_time, tt, gt}))
+    sendLobby(*lobby, Message(Request::UPDATE_LOBBY, std::move(*params)));
+  else
+    send(fd, Message(Request::UPDATE_LOBBY, Message::LobbyParameters(lobby->parameters())));  // Undo the client's change
+}
+
+void Server::updateMember(int fd, const Message& message) {
+  const string& you = connections.at(fd).username;
+  ServerLobby* lobby = lobbyOf(fd);
+  auto member = message.extract_view<Message::SlotLobby>();
+  if (!lobby || !member || member->name != you || lobby->started())
+    return;
+
+  if (member->s == ServerLobby::Slot::QUITTING)
+    quitLobby(fd);
+  else if (lobby->seat(you, member->s))
+    sendLobby(*lobby, Message(Request::UPDATE_LOBBY_MEMBER, Message::SlotLobby(you, member->s)));
+}
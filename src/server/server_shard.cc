@@ -0,0 +1,349 @@
+#include "server_shard.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <span>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <pthread.h>
+
+#include "../common/utils.hh"
+
+using Request = Networkable::Request;
+using NM::Message;
+
+//                   ╔════════════╗
+//                   ║ Event Loop ║
+//                   ╚════════════╝
+
+Shard::Shard(Mailbox<Mail::ToAcceptor>& acceptor, std::chrono::milliseconds spectator_delay)
+  : acceptor{acceptor}, spectator_delay{spectator_delay} {
+  epoll_event event{.events = EPOLLIN | EPOLLET, .data{.fd = inbox.fd()}};
+  if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inbox.fd(), &event) == -1) {
+    std::cerr << "Could not start shard: " << std::strerror(errno) << '\n';
+    return;
+  }
+
+  // Signals are for the acceptor, whose epoll_wait they interrupt
+  sigset_t all, previous;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &previous);
+  thread = std::jthread([this](std::stop_token stop) { run(stop); });
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+Shard::~Shard() {
+  thread.request_stop();
+  inbox.wake();
+  if (thread.joinable())
+    thread.join();
+
+  // The acceptor closes the sockets, as it does all of them
+  for (auto&& [fd, player] : players)
+    write_message(fd, Message(Request::DISCONNECT));
+  if (epoll_fd != -1)
+    close(epoll_fd);
+}
+
+void Shard::run(std::stop_token stop) {
+  array<epoll_event, MAX_EVENTS> events;
+
+  while (!stop.stop_requested()) {
+    // Only woken by the clocks when a deadline may be due
+    int ready = epoll_wait(epoll_fd, events.data(), MAX_EVENTS, clocks.timeout(TimerWheel::Clock::now()));
+    if (ready == -1) {
+      if (errno == EINTR)
+        continue;
+      std::cerr << "Shard event loop failed: " << std::strerror(errno) << '\n';
+      return;
+    }
+
+    for (const epoll_event& event : std::span{events}.first(static_cast<size_t>(ready))) {
+      int fd = event.data.fd;
+      if (fd == inbox.fd()) {
+        collect();
+        continue;
+      }
+
+      if (!players.contains(fd))
+        continue;  // Left earlier in this batch
+      if (event.events & EPOLLOUT && !flush(fd))
+        leave(fd, true);
+      else if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        receive(fd);
+    }
+
+    for (uint64_t key : clocks.advance(TimerWheel::Clock::now())) {
+      if (key & RELAY)
+        relay(key & ~RELAY);
+      else
+        expire(key);
+    }
+  }
+}
+
+void Shard::collect() {
+  auto ours = [this](int fd, uint64_t session) {
+    auto it = players.find(fd);
+    return it != players.end() && it->second.session == session;
+  };
+
+  for (Mail::ToShard& mail : inbox.drain()) {
+    if (auto* start = std::get_if<Mail::Start>(&mail)) {
+      this->start(std::move(*start));
+    } else if (auto* delivery = std::get_if<Mail::Deliver>(&mail)) {
+      if (ours(delivery->fd, delivery->session))
+        send(delivery->fd, std::move(delivery->message));
+      else  // Given back meanwhile, the acceptor sends it
+        acceptor.push(std::move(*delivery));
+    } else if (auto* forward = std::get_if<Mail::Forward>(&mail)) {
+      if (ours(forward->fd, forward->session))
+        handle(forward->fd, forward->message);
+    }
+  }
+}
+
+void Shard::start(Mail::Start&& start) {
+  auto name = [&](Mail::Role role) -> string_view {
+    auto it = ranges::find(start.members, role, &Mail::Member::role);
+    return it == start.members.end() ? string_view{} : it->username;
+  };
+  Match& match = matches.try_emplace(start.match, ServerGame(start.parameters, name(Mail::Role::LEFT), name(Mail::Role::RIGHT)),
+                                     std::move(start.lobby), vector<int>{}, start.parameters).first->second;
+  match.remaining.fill(std::get<0>(start.parameters));
+
+  for (Mail::Member& member : start.members) {
+    adopt(std::move(member.peer));
+    players.emplace(member.fd, Player{start.match, member.session, member.role});
+    match.members.push_back(member.fd);
+    load.fetch_add(1, std::memory_order_relaxed);
+
+    // Whatever arrived during the hand-over is reported as soon as it is added
+    epoll_event event{.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data{.fd = member.fd}};
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, member.fd, &event);
+  }
+
+  for (Mail::Member& member : start.members)
+    send(member.fd, Message(member.role == Mail::Role::SPECTATOR ? Request::START_SPECTATING : Request::START_GAME));
+}
+
+//                   ╔══════════╗
+//                   ║ Dispatch ║
+//                   ╚══════════╝
+
+void Shard::receive(int fd) {
+  for (const Message& message : read_messages(fd)) {
+    if (message.empty()) {
+      leave(fd, true);
+      return;
+    }
+    handle(fd, message);
+    if (!players.contains(fd))
+      return;
+  }
+}
+
+void Shard::handle(int fd, const Message& message) {
+  Player& player = players.at(fd);
+
+  switch (message.request()) {
+    using enum Networkable::Request;
+    case GAME:
+    case OUT_OF_TIME:
+      if (player.role != Mail::Role::SPECTATOR) {
+        uint64_t id  = player.match;
+        Match& match = matches.at(id);
+        auto seat    = player.role == Mail::Role::LEFT ? ServerGame::Seat::LEFT : ServerGame::Seat::RIGHT;
+        deliver(id, match, match.game.handle(seat, message));
+        // Sending may have made everyone leave
+        if (auto it = matches.find(id); it != matches.end())
+          clock(id, it->second);
+      }
+      break;
+    case CLOCK:
+      if (Message answer = answerClock(message); !answer.empty())
+        send(fd, std::move(answer));
+      break;
+    case BACK_TO_LOBBY:
+      send(fd, Message(BACK_TO_LOBBY));
+      if (players.contains(fd))
+        leave(fd, false);
+      break;
+    case DISCONNECT:
+      leave(fd, true);
+      break;
+    case CHAT_MESSAGE:
+    case LOAD_CHAT:
+    case UPDATE_RELATIONSHIPS:
+      // Accounts and chats belong to the acceptor
+      acceptor.push(Mail::Forward{fd, player.session, message});
+      break;
+    default:
+      break;  // Menus are out of reach during a match
+  }
+}
+
+void Shard::deliver(uint64_t id, Match& match, vector<ServerGame::Delivery>&& deliveries) {
+  auto concerned = [](Mail::Role role, ServerGame::Audience to) {
+    switch (to) {
+      using enum ServerGame::Audience;
+      case LEFT:       return role == Mail::Role::LEFT;
+      case RIGHT:      return role == Mail::Role::RIGHT;
+      case SPECTATORS: return role == Mail::Role::SPECTATOR;
+      case EVERYONE:
+      default:         return true;
+    }
+  };
+
+  // By role, each recipient only being in one, so that everyone gets their messages in order
+  array<vector<int>, 3> audiences;
+  array<vector<Message>, 3> messages;
+  for (int fd : match.members)
+    if (auto it = players.find(fd); it != players.end())
+      audiences.at(static_cast<size_t>(it->second.role)).push_back(fd);
+  for (ServerGame::Delivery& delivery : deliveries)
+    for (Mail::Role role : {Mail::Role::LEFT, Mail::Role::RIGHT, Mail::Role::SPECTATOR})
+      if (concerned(role, delivery.to))
+        messages.at(static_cast<size_t>(role)).push_back(delivery.message);
+
+  vector<int> broken;
+  for (Mail::Role role : {Mail::Role::LEFT, Mail::Role::RIGHT})
+    if (auto&& audience = audiences.at(static_cast<size_t>(role)); !audience.empty() && !messages.at(static_cast<size_t>(role)).empty())
+      ranges::copy(broadcast(audience, messages.at(static_cast<size_t>(role))), std::back_inserter(broken));
+
+  auto&& spectators = audiences.at(static_cast<size_t>(Mail::Role::SPECTATOR));
+  auto&& watched    = messages.at(static_cast<size_t>(Mail::Role::SPECTATOR));
+  if (!spectators.empty() && !watched.empty()) {
+    if (spectator_delay == std::chrono::milliseconds::zero()) {
+      ranges::copy(broadcast(spectators, watched), std::back_inserter(broken));
+    } else {
+      auto due = TimerWheel::Clock::now() + spectator_delay;
+      if (match.delayed.empty())
+        static_cast<void>(clocks.arm(due, id | RELAY));
+      for (Message& message : watched)
+        match.delayed.emplace_back(due, std::move(message));
+    }
+  }
+
+  // Only now, as leaving may erase the match
+  drop(broken);
+}
+
+void Shard::relay(uint64_t id) {
+  auto it = matches.find(id);
+  if (it == matches.end())
+    return;
+  Match& match = it->second;
+
+  TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+  vector<Message> due;
+  while (!match.delayed.empty() && match.delayed.front().first <= now) {
+    due.push_back(std::move(match.delayed.front().second));
+    match.delayed.pop_front();
+  }
+  if (!match.delayed.empty())
+    static_cast<void>(clocks.arm(match.delayed.front().first, id | RELAY));
+
+  vector<int> spectators;
+  for (int fd : match.members)
+    if (auto player = players.find(fd); player != players.end() && player->second.role == Mail::Role::SPECTATOR)
+      spectators.push_back(fd);
+  drop(broadcast(spectators, due));
+}
+
+void Shard::drop(const vector<int>& broken) {
+  for (int fd : broken)
+    if (players.contains(fd))
+      leave(fd, true);
+}
+
+void Shard::send(int fd, Message&& message) {
+  if (!write_message(fd, std::move(message)))
+    leave(fd, true);
+}
+
+void Shard::leave(int fd, bool hung_up) {
+  auto node = players.extract(fd);
+  if (node.empty())
+    return;
+  Player& player = node.mapped();
+  Match& match   = matches.at(player.match);
+
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  std::erase(match.members, fd);
+  load.fetch_sub(1, std::memory_order_relaxed);
+  acceptor.push(Mail::Return{fd, player.session, release(fd), hung_up});
+
+  if (player.role != Mail::Role::SPECTATOR)
+    deliver(player.match, match, match.game.forfeit(player.role == Mail::Role::LEFT ? ServerGame::Seat::LEFT : ServerGame::Seat::RIGHT));
+
+  // Telling the others may have made them leave too, and erased the match
+  auto it = matches.find(player.match);
+  if (it == matches.end())
+    return;
+  clock(player.match, it->second);
+  it = matches.find(player.match);
+  if (it != matches.end() && it->second.members.empty()) {
+    acceptor.push(Mail::Over{std::move(it->second.lobby)});
+    matches.erase(it);
+  }
+}
+
+//                   ╔════════╗
+//                   ║ Clocks ║
+//                   ╚════════╝
+
+void Shard::clock(uint64_t id, Match& match) {
+  std::optional<ServerGame::Seat> turn = match.game.playing();
+  if (turn == match.running)
+    return;
+
+  auto&& [game_time, turn_time, type, mode] = match.parameters;
+  TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+  std::optional<ServerGame::Seat> previous = std::exchange(match.running, turn);
+  // Clients are told the deadlines without the grace, to run out on time by our clock
+  auto tell = [](ServerGame::Audience to, TimerWheel::Clock::time_point game, std::optional<TimerWheel::Clock::time_point> turn) {
+    return ServerGame::Delivery{to, Message(Request::CLOCK, Message::Deadline(Timer::toWire(game), turn ? Timer::toWire(*turn) : chrono::microseconds{}))};
+  };
+
+  if (type == Timer::Type::GLOBAL) {
+    // One clock for the whole match, from the first shot until the end
+    if (!turn) {
+      clocks.cancel(match.deadline);
+    } else if (!previous) {
+      match.deadline = clocks.arm(now + game_time + GRACE, id);
+      deliver(id, match, {tell(ServerGame::Audience::LEFT, now + game_time, {}), tell(ServerGame::Audience::RIGHT, now + game_time, {})});
+    }
+    return;
+  }
+
+  // Each player's game time only runs during their turns, which are limited too
+  if (previous)
+    match.remaining.at(static_cast<size_t>(*previous)) -= now - match.since;
+  match.since = now;
+  clocks.cancel(match.deadline);
+  if (turn) {
+    auto remaining = match.remaining.at(static_cast<size_t>(*turn));
+    // Game time spent during the last grace leaves no grace to this turn
+    match.deadline = clocks.arm(remaining <= TimerWheel::Clock::duration{} ? now : now + std::min<TimerWheel::Clock::duration>(remaining, turn_time) + GRACE, id);
+    auto to = *turn == ServerGame::Seat::LEFT ? ServerGame::Audience::LEFT : ServerGame::Audience::RIGHT;
+    deliver(id, match, {tell(to, now + remaining, now + turn_time)});
+  }
+}
+
+void Shard::expire(uint64_t id) {
+  auto it = matches.find(id);
+  if (it == matches.end() || !it->second.running)
+    return;
+
+  Match& match = it->second;
+  match.deadline = {};
+  // With turn timers, only the turn is lost until the game time is spent too
+  ServerGame::Seat seat = *match.running;
+  bool spent = std::get<2>(match.parameters) == Timer::Type::TURN
+            && match.remaining.at(static_cast<size_t>(seat)) <= TimerWheel::Clock::now() - match.since;
+  deliver(id, match, spent ? match.game.forfeit(seat) : match.game.handle(seat, Message(Request::OUT_OF_TIME)));
+  if (auto still = matches.find(id); still != matches.end())
+    clock(id, still->second);
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <sys/epoll.h>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <variant>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "mailbox.hh"
+#include "server_game.hh"
+#include "timer_wheel.hh"
+
+#include "../common/network_io.hh"
+#include "../common/serializer.hh"
+
+using std::string, std::vector;
+
+//                   ╔═══════╗
+//                   ║ Mails ║
+//                   ╚═══════╝
+
+/**
+ * Sockets are identified by their descriptor and by a session number, as
+ * a descriptor closed while a mail was in flight may already be reused.
+ */
+namespace Mail {
+  enum class Role : uint8_t {
+    LEFT,
+    RIGHT,
+    SPECTATOR
+  };
+
+  struct Member {
+    int fd;
+    uint64_t session;
+    string username;
+    Role role;
+    Networkable::PeerState peer;
+  };
+
+  // Acceptor to shard: a lobby starting its match, with its members' sockets
+  struct Start {
+    uint64_t match;
+    string lobby;
+    Lobby::parameter_t parameters;
+    vector<Member> members;
+  };
+
+  // Either way: a message to send on a socket the other side owns
+  struct Deliver {
+    int fd;
+    uint64_t session;
+    NM::Message message;
+  };
+
+  // Either way: a request read by one side that the other handles
+  struct Forward {
+    int fd;
+    uint64_t session;
+    NM::Message message;
+  };
+
+  // Shard to acceptor: a socket given back, closed if they hung up
+  struct Return {
+    int fd;
+    uint64_t session;
+    Networkable::PeerState peer;
+    bool hung_up;
+  };
+
+  // Shard to acceptor: everyone left, the lobby may start another match
+  struct Over {
+    string lobby;
+  };
+
+  // Hashing worker to acceptor: a LOGIN or REGISTER whose password was hashed
+  struct Hashed {
+    int fd;
+    uint64_t session;
+    Networkable::Request request;
+    string name;
+    string password;  // Cleared once hashed
+    string hash;      // Of the account on LOGIN, new one on REGISTER, empty if it failed
+    bool accepted = false;
+  };
+
+  using ToShard    = std::variant<Start, Deliver, Forward>;
+  using ToAcceptor = std::variant<Deliver, Forward, Return, Over, Hashed>;
+}
+
+/**
+ * Event loop on its own thread, running the matches the acceptor gave it.
+ * A match is handed over whole, players and spectators, with their
+ * sockets: everything about it is then read, decided and written on this
+ * thread alone, so games need no lock. Sockets go back to the acceptor
+ * when their owner leaves the match.
+ */
+class Shard : protected Networkable {
+  static constexpr int MAX_EVENTS = 256;
+
+  struct Player {
+    uint64_t match;
+    uint64_t session;
+    Mail::Role role;
+  };
+
+  struct Match {
+    ServerGame game;
+    string lobby;
+    vector<int> members;
+    Lobby::parameter_t parameters;
+
+    // Clocks, counted as the players' clients count them
+    std::optional<ServerGame::Seat> running;              // Whose turn the clock last saw
+    TimerWheel::Clock::time_point since;                  // Start of that turn
+    array<TimerWheel::Clock::duration, 2> remaining{};    // Game time left to each player, by turn
+    TimerWheel::Handle deadline;
+
+    // Messages held back from spectators, with when to relay them
+    std::deque<std::pair<TimerWheel::Clock::time_point, NM::Message>> delayed;
+  };
+
+  // Clients count whole seconds from when they hear of the turn, and tell
+  // us when they run out: the server only steps in for those that do not
+  static constexpr auto GRACE = std::chrono::seconds(1);
+
+  static constexpr uint64_t RELAY = uint64_t{1} << 63;  // Tags the timers relaying to spectators, among deadlines
+
+  int epoll_fd = -1;
+  Mailbox<Mail::ToShard> inbox;
+  Mailbox<Mail::ToAcceptor>& acceptor;
+
+  std::unordered_map<int, Player> players;   // Every socket of the shard
+  std::unordered_map<uint64_t, Match> matches;
+  std::atomic<size_t> load = 0;              // Sockets owned, for the acceptor to balance
+  TimerWheel clocks;                         // Turn and game deadlines of every match, and relays
+  std::chrono::milliseconds spectator_delay;
+
+  std::jthread thread;
+
+  void run(std::stop_token stop);
+  void collect();
+
+  void start(Mail::Start&& start);
+  void receive(int fd);
+  void handle(int fd, const NM::Message& message);
+
+  /**
+   * Rearms a match's deadline after a move, if the turn changed hands,
+   * combat started or the match ended, and tells the players whose
+   * clock started. Sending may erase the match.
+   */
+  void clock(uint64_t id, Match& match);
+
+  /**
+   * Runs out the time of whoever's turn it is, as if they had said so.
+   */
+  void expire(uint64_t id);
+
+  /**
+   * Sends what a match decided to the members concerned, each audience's
+   * messages encoded once for all of its members. Spectators get theirs
+   * once the spectator delay passed, if there is one. Sending may erase
+   * the match.
+   */
+  void deliver(uint64_t id, Match& match, vector<ServerGame::Delivery>&& deliveries);
+
+  /**
+   * Sends spectators every message held back that is due, together.
+   */
+  void relay(uint64_t id);
+
+  /**
+   * Makes the recipients of a broadcast that broke leave.
+   */
+  void drop(const vector<int>& broken);
+
+  /**
+   * Sends a message, making its recipient leave if the connection broke.
+   */
+  void send(int fd, NM::Message&& message);
+
+  /**
+   * Gives a socket back to the acceptor, forfeiting for a player leaving
+   * a match still going on.
+   */
+  void leave(int fd, bool hung_up);
+
+ public:
+  Shard(Mailbox<Mail::ToAcceptor>& acceptor, std::chrono::milliseconds spectator_delay);
+  ~Shard();
+
+  inline void post(Mail::ToShard&& mail) { inbox.push(std::move(mail)); }
+
+  [[nodiscard]] inline size_t sockets() const { return load.load(std::memory_order_relaxed); }
+
+  Shard(Shard&&)      = delete;
+  Shard(const Shard&) = delete;
+};
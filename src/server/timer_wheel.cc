@@ -0,0 +1,153 @@
+#include "timer_wheel.hh"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <utility>
+
+TimerWheel::TimerWheel(Clock::time_point now) : origin{now} {
+  for (auto&& level : heads)
+    level.fill(NONE);
+}
+
+uint64_t TimerWheel::ticks(Clock::time_point time) const {
+  return time <= origin ? 0 : static_cast<uint64_t>((time - origin) / TICK);
+}
+
+TimerWheel::Handle TimerWheel::arm(Clock::time_point deadline, uint64_t key) {
+  uint32_t index;
+  if (free != NONE) {
+    index = free;
+    free  = nodes[index].next;
+  } else {
+    index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+  }
+
+  // Rounded up, and never in a tick already handled
+  Node& node    = nodes[index];
+  uint64_t due  = ticks(deadline);
+  node.deadline = std::max(origin + due * TICK < deadline ? due + 1 : due, now_tick + 1);
+  node.key      = key;
+  node.armed    = true;
+  ++armed;
+
+  insert(index);
+  return {index, node.generation};
+}
+
+bool TimerWheel::cancel(Handle handle) {
+  if (handle.index >= nodes.size())
+    return false;
+  Node& node = nodes[handle.index];
+  if (!node.armed || node.generation != handle.generation)
+    return false;
+
+  unlink(handle.index);
+  node.armed = false;
+  ++node.generation;
+  node.next = std::exchange(free, handle.index);
+  --armed;
+  return true;
+}
+
+void TimerWheel::insert(uint32_t index) {
+  Node& node = nodes[index];
+  // Deadlines beyond the top level come back to it when their slot is reached
+  uint64_t at    = std::min(node.deadline, now_tick + span(LEVELS) - 1);
+  uint64_t delta = at - now_tick;
+
+  size_t level = 0;
+  while (level + 1 < LEVELS && delta >= span(level + 1))
+    ++level;
+  size_t slot = (at >> (BITS * level)) & (SLOTS - 1);
+
+  uint32_t& head = heads[level][slot];
+  node.slot      = static_cast<uint16_t>(level * SLOTS + slot);
+  node.previous  = NONE;
+  node.next      = head;
+  if (head != NONE)
+    nodes[head].previous = index;
+  head = index;
+  occupied[level] |= uint64_t{1} << slot;
+}
+
+void TimerWheel::unlink(uint32_t index) {
+  Node& node   = nodes[index];
+  size_t level = node.slot / SLOTS;
+  size_t slot  = node.slot % SLOTS;
+
+  if (node.previous == NONE)
+    heads[level][slot] = node.next;
+  else
+    nodes[node.previous].next = node.next;
+  if (node.next != NONE)
+    nodes[node.next].previous = node.previous;
+
+  if (heads[level][slot] == NONE)
+    occupied[level] &= ~(uint64_t{1} << slot);
+}
+
+void TimerWheel::cascade(size_t level) {
+  size_t slot = (now_tick >> (BITS * level)) & (SLOTS - 1);
+  uint32_t index = std::exchange(heads[level][slot], NONE);
+  occupied[level] &= ~(uint64_t{1} << slot);
+
+  while (index != NONE) {
+    uint32_t next = nodes[index].next;
+    insert(index);
+    index = next;
+  }
+}
+
+std::vector<uint64_t> TimerWheel::advance(Clock::time_point now) {
+  std::vector<uint64_t> due;
+  uint64_t target = ticks(now);
+
+  while (now_tick < target && armed > due.size()) {
+    ++now_tick;
+
+    // Highest level first, as what it moves down may land in the slot of the next one reached
+    size_t top = 0;
+    while (top + 1 < LEVELS && (now_tick & (span(top + 1) - 1)) == 0)
+      ++top;
+    for (size_t level = top; level > 0; --level)
+      cascade(level);
+
+    size_t slot = now_tick & (SLOTS - 1);
+    uint32_t index = std::exchange(heads[0][slot], NONE);
+    occupied[0] &= ~(uint64_t{1} << slot);
+    while (index != NONE) {
+      Node& node = nodes[index];
+      due.push_back(node.key);
+      node.armed = false;
+      ++node.generation;
+      index = std::exchange(node.next, std::exchange(free, index));
+    }
+  }
+
+  armed -= due.size();
+  now_tick = std::max(now_tick, target);  // Nothing was left to fire in between
+  return due;
+}
+
+int TimerWheel::timeout(Clock::time_point now) const {
+  if (armed == 0)
+    return -1;
+
+  uint64_t next = UINT64_MAX;
+  for (size_t level = 0; level < LEVELS; ++level) {
+    if (occupied[level] == 0)
+      continue;
+    // First slot of the level reached from here on, wrapping around
+    uint64_t period = (now_tick >> (BITS * level)) + 1;
+    uint64_t ahead  = static_cast<uint64_t>(std::countr_zero(std::rotr(occupied[level], static_cast<int>(period & (SLOTS - 1)))));
+    next = std::min(next, (period + ahead) << (BITS * level));
+  }
+
+  auto wait = origin + next * TICK - now;
+  if (wait <= Clock::duration::zero())
+    return 0;
+  auto milliseconds = std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+  return static_cast<int>(std::min<decltype(milliseconds)>(milliseconds, INT_MAX));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Deadlines of every match of a shard, on the monotonic clock, in a
+ * hierarchical timing wheel: LEVELS wheels of SLOTS lists each, every
+ * level's slot spanning a whole turn of the level below. A timer is put
+ * in the lowest level whose span reaches its deadline, and moved down a
+ * level each time the one below has turned to its slot, until it fires.
+ *
+ * Arming and cancelling are O(1): timers are nodes of intrusive lists,
+ * kept in one vector and reused. Nothing runs on its own, the owner's
+ * event loop sleeps for timeout() and then calls advance().
+ */
+class TimerWheel {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr auto   TICK   = std::chrono::milliseconds(10);
+  static constexpr size_t SLOTS  = 64;
+  static constexpr size_t LEVELS = 4;  // 64^4 ticks, 46 hours; later deadlines are checked again when reached
+
+  /**
+   * Refers to an armed timer, stale once it fired or was cancelled.
+   */
+  struct Handle {
+    uint32_t index      = NONE;
+    uint32_t generation = 0;
+  };
+
+  explicit TimerWheel(Clock::time_point now = Clock::now());
+
+  /**
+   * Never fires before the deadline, at most a tick after.
+   *
+   * \param When to fire.
+   * \param What advance() returns once it does.
+   */
+  [[nodiscard]] Handle arm(Clock::time_point deadline, uint64_t key);
+
+  /**
+   * \return Whether the timer was still armed.
+   */
+  bool cancel(Handle handle);
+
+  /**
+   * Brings the wheel to now.
+   *
+   * \return Keys of every timer due, by deadline.
+   */
+  [[nodiscard]] std::vector<uint64_t> advance(Clock::time_point now);
+
+  /**
+   * Time to sleep before advance() may have anything to do: the next
+   * occupied slot of the first level, or the next time a higher level
+   * moves an occupied slot down.
+   *
+   * \return Milliseconds to wait, -1 if nothing is armed, as epoll_wait takes it.
+   */
+  [[nodiscard]] int timeout(Clock::time_point now) const;
+
+  [[nodiscard]] inline size_t size() const { return armed; }
+
+ private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+  static constexpr size_t   BITS = 6;  // log2(SLOTS)
+  static_assert(SLOTS == 1 << BITS);
+
+  // Ticks covered by that many levels
+  [[nodiscard]] static constexpr uint64_t span(size_t levels) { return uint64_t{1} << (BITS * levels); }
+
+  struct Node {
+    uint64_t deadline;  // In ticks
+    uint64_t key;
+    uint32_t previous   = NONE;
+    uint32_t next       = NONE;  // Also links free nodes
+    uint32_t generation = 0;
+    uint16_t slot       = 0;     // Level * SLOTS + slot, to clear its bit when last out
+    bool     armed      = false;
+  };
+
+  Clock::time_point origin;
+  uint64_t now_tick = 0;  // Every tick up to this one was handled
+  size_t   armed    = 0;
+
+  std::vector<Node> nodes;
+  uint32_t free = NONE;
+  std::array<std::array<uint32_t, SLOTS>, LEVELS> heads;
+  std::array<uint64_t, LEVELS> occupied{};  // A bit per non-empty slot
+
+  [[nodiscard]] uint64_t ticks(Clock::time_point time) const;
+  void insert(uint32_t index);
+  void unlink(uint32_t index);
+  void cascade(size_t level);
+};